@@ -6,9 +6,19 @@
 #include "cpu_tromp.hpp"
 
 
-void CPU_TROMP::start(CPU_TROMP& device_context) { }
+// The solver state is hundreds of MB; allocate it once per instance rather than per solve
+void CPU_TROMP::start(CPU_TROMP& device_context)
+{
+	if (!device_context.eq)
+		device_context.eq = new equi(1);
+	device_context.index_vector.resize(PROOFSIZE);
+}
 
-void CPU_TROMP::stop(CPU_TROMP& device_context) { }
+void CPU_TROMP::stop(CPU_TROMP& device_context)
+{
+	delete device_context.eq;
+	device_context.eq = nullptr;
+}
 
 void CPU_TROMP::solve(const char *tequihash_header,
 	unsigned int tequihash_header_len,
@@ -19,25 +29,30 @@ void CPU_TROMP::solve(const char *tequihash_header,
 	std::function<void(void)> hashdonef,
 	CPU_TROMP& device_context)
 {
-	equi eq(1);
+	if (!device_context.eq)
+		start(device_context);
+	equi& eq = *device_context.eq;
 	eq.setnonce(tequihash_header, tequihash_header_len, nonce, nonce_len);
+	eq.sched.reset(NBLOCKS);
 	eq.digit0(0);
 	eq.xfull = eq.bfull = eq.hfull = 0;
 	u32 r = 1;
 
 	for (; r < WK; r++) {
 		if (cancelf()) return;
+		eq.sched.reset(NBUCKETS);
 		r & 1 ? eq.digitodd(r, 0) : eq.digiteven(r, 0);
 		eq.xfull = eq.bfull = eq.hfull = 0;
 	}
 
 	if (cancelf()) return;
 
+	eq.sched.reset(NBUCKETS);
 	eq.digitK(0);
 
 	for (unsigned s = 0; s < eq.nsols; s++)
 	{
-		std::vector<uint32_t> index_vector(PROOFSIZE);
+		std::vector<uint32_t>& index_vector = device_context.index_vector;
 		for (u32 i = 0; i < PROOFSIZE; i++) {
 			index_vector[i] = eq.sols[s][i];
 		}
@@ -1,3 +1,5 @@
+struct equi;
+
 #ifdef WIN32
 
 #ifdef _USRDLL
@@ -30,6 +32,8 @@ struct DLL_CPU_TROMP CPU_TROMP
     std::string getname() { return CPU_TROMP_NAME; }
 
     int use_opt;
+    equi* eq = nullptr; // kept across solves, allocated in start()
+    std::vector<uint32_t> index_vector;
 };
 
 #endif
@@ -63,6 +67,8 @@ struct DLL_CPU_TROMP CPU_TROMP
 	std::string getname() { return CPU_TROMP_NAME; }
 
 	int use_opt;
+	equi* eq = nullptr; // kept across solves, allocated in start()
+	std::vector<uint32_t> index_vector;
 };
 
 #endif
@@ -98,6 +104,8 @@ struct CPU_TROMP
     std::string getname() { return CPU_TROMP_NAME; }
 
     int use_opt;
+    equi* eq = nullptr; // kept across solves, allocated in start()
+    std::vector<uint32_t> index_vector;
 };
 
 #endif
@@ -19,10 +19,14 @@
 // twice the number of subtrees expected to land there.
 
 #include "equi.h"
+#include "../nheqminer/workstealing.hpp"
 #include <stdio.h>
 #include <stdlib.h>
+#include <new>
 #ifndef WIN32
 #include <pthread.h>
+#else
+#include <malloc.h>
 #endif
 #include <assert.h>
 
@@ -72,6 +76,8 @@ static const u32 NRESTS = 1<<RESTBITS;
 static const u32 NBLOCKS = (NHASHES+HASHESPERBLAKE-1)/HASHESPERBLAKE;
 // nothing larger found in 100000 runs
 static const u32 MAXSOLS = 8;
+// buckets (or blake blocks) handed out per work-stealing grab
+static const u32 SCHEDCHUNK = 16;
 
 // tree node identifying its children as two different slots in
 // a bucket on previous layer with the same rest bits (x-tra hash)
@@ -212,7 +218,8 @@ struct equi {
   u32 hfull;
   u32 bfull;
   pthread_barrier_t barry;
-  equi(const u32 n_threads) {
+  WorkStealingScheduler sched;
+  equi(const u32 n_threads) : sched(n_threads, SCHEDCHUNK) {
     assert(sizeof(hashunit) == 4);
     nthreads = n_threads;
     const int err = pthread_barrier_init(&barry, NULL, nthreads);
@@ -226,9 +233,29 @@ struct equi {
     free(nslots);
     free(sols);
   }
+  // blake_ctx needs its 64-byte alignment, which plain new does not honour before C++17
+  static void *operator new(size_t sz) {
+#ifdef WIN32
+    void *mem = _aligned_malloc(sz, alignof(equi));
+#else
+    void *mem;
+    if (posix_memalign(&mem, alignof(equi), sz))
+      mem = nullptr;
+#endif
+    if (!mem)
+      throw std::bad_alloc();
+    return mem;
+  }
+  static void operator delete(void *mem) {
+#ifdef WIN32
+    _aligned_free(mem);
+#else
+    free(mem);
+#endif
+  }
   void setnonce(const char *header, const u32 headerLen, const char* nonce, u32 nonceLen) {
 	  setheader(&blake_ctx, header, headerLen, nonce, nonceLen);
-	  memset(nslots, 0, NBUCKETS * sizeof(au32)); // only nslots[0] needs zeroing
+	  memset(nslots, 0, 2 * NBUCKETS * sizeof(au32)); // a cancelled solve leaves counts in both
 	  nsols = 0;
   }
   u32 getslot(const u32 r, const u32 bucketi) {
@@ -363,11 +390,25 @@ struct equi {
 
   struct collisiondata {
 #ifdef XBITMAP
-#if NSLOTS > 64
-#error cant use XBITMAP with more than 64 slots
+    // one bit per slot for every xhash, spread over XWORDS words;
+    // the summary has a bit for each word written since clear(),
+    // so clear() only wipes the summaries and stale words are overwritten.
+    // Word-major, as slots arrive in order and mostly touch one word row
+    static const u32 XWORDS = (NSLOTS + 63) / 64;
+#if RESTBITS <= 8
+    typedef u16 xsummary;
+#else
+    typedef u32 xsummary;
 #endif
-    u64 xhashmap[NRESTS];
-    u64 xmap;
+    static_assert(XWORDS <= 8 * sizeof(xsummary), "too many slots for XBITMAP");
+    u64 xhashmap[XWORDS][NRESTS];
+    xsummary xhashsummary[NRESTS];
+    u32 xrest;
+    u32 xwords; // summary bits still to visit
+    u32 xword;  // word being visited
+    u64 xmap;   // slot bits still to visit in xword
+    u32 lastword;
+    u64 lastmask; // slots of lastword below the one just added
 #else
 #if RESTBITS <= 6
     typedef uchar xslot;
@@ -384,16 +425,40 @@ struct equi {
 
     void clear() {
 #ifdef XBITMAP
-      memset(xhashmap, 0, NRESTS * sizeof(u64));
+      memset(xhashsummary, 0, NRESTS * sizeof(xsummary));
 #else
       memset(nxhashslots, 0, NRESTS * sizeof(xslot));
 #endif
     }
+#ifdef XBITMAP
+    void nextword() {
+      if (!xwords) {
+        xmap = 0;
+        return;
+      }
+      xword = __builtin_ctz(xwords);
+      xwords &= xwords - 1;
+      xmap = xhashmap[xword][xrest];
+      if (xword == lastword)
+        xmap &= lastmask;
+    }
+#endif
     bool addslot(u32 s1, u32 xh) {
 #ifdef XBITMAP
-      xmap = xhashmap[xh];
-      xhashmap[xh] |= (u64)1 << s1;
-      s0 = -1;
+      const u32 w = s1 / 64;
+      const u64 bit = (u64)1 << (s1 % 64);
+      xwords = xhashsummary[xh];
+      if (xwords >> w & 1) {
+        xhashmap[w][xh] |= bit;
+      } else {
+        xhashmap[w][xh] = bit;
+        xhashsummary[xh] |= (xsummary)1 << w;
+      }
+      // slots arrive in increasing order, so every earlier slot is a collision
+      xrest = xh;
+      lastword = w;
+      lastmask = bit - 1;
+      nextword();
       return true;
 #else
       n1 = (u32)nxhashslots[xh]++;
@@ -414,8 +479,10 @@ struct equi {
     }
     u32 slot() {
 #ifdef XBITMAP
-      const u32 ffs = __builtin_ffsll(xmap);
-      s0 += ffs; xmap >>= ffs;
+      s0 = xword * 64 + __builtin_ctzll(xmap);
+      xmap &= xmap - 1;
+      if (!xmap)
+        nextword();
       return s0;
 #else
       return (u32)xx[n0++];
@@ -428,7 +495,9 @@ struct equi {
     blake2b_state state;
     htlayout htl(this, 0);
     const u32 hashbytes = hashsize(0);
-    for (u32 block = id; block < NBLOCKS; block += nthreads) {
+    u32 bbegin, bend;
+    while (sched.next(id, bbegin, bend))
+    for (u32 block = bbegin; block < bend; block++) {
       state = blake_ctx;
       u32 leb = block;
       blake2b_update(&state, (uchar *)&leb, sizeof(u32));
@@ -462,7 +531,9 @@ struct equi {
   void digitodd(const u32 r, const u32 id) {
     htlayout htl(this, r);
     collisiondata cd;
-    for (u32 bucketid=id; bucketid < NBUCKETS; bucketid += nthreads) {
+    u32 bbegin, bend;
+    while (sched.next(id, bbegin, bend))
+    for (u32 bucketid = bbegin; bucketid < bend; bucketid++) {
       cd.clear();
       slot0 *buck = htl.hta.trees0[(r-1)/2][bucketid]; // optimize by updating previous buck?!
       u32 bsize = getnslots(r-1, bucketid);       // optimize by putting bucketsize with block?!
@@ -511,7 +582,9 @@ struct equi {
   void digiteven(const u32 r, const u32 id) {
     htlayout htl(this, r);
     collisiondata cd;
-    for (u32 bucketid=id; bucketid < NBUCKETS; bucketid += nthreads) {
+    u32 bbegin, bend;
+    while (sched.next(id, bbegin, bend))
+    for (u32 bucketid = bbegin; bucketid < bend; bucketid++) {
       cd.clear();
       slot1 *buck = htl.hta.trees1[(r-1)/2][bucketid]; // OPTIMIZE BY UPDATING PREVIOUS
       u32 bsize = getnslots(r-1, bucketid);
@@ -560,7 +633,9 @@ struct equi {
   void digitK(const u32 id) {
     collisiondata cd;
     htlayout htl(this, WK);
-    for (u32 bucketid = id; bucketid < NBUCKETS; bucketid += nthreads) {
+    u32 bbegin, bend;
+    while (sched.next(id, bbegin, bend))
+    for (u32 bucketid = bbegin; bucketid < bend; bucketid++) {
       cd.clear();
       slot0 *buck = htl.hta.trees0[(WK-1)/2][bucketid];
       u32 bsize = getnslots(WK-1, bucketid);
@@ -597,14 +672,17 @@ void *worker(void *vp) {
   thread_ctx *tp = (thread_ctx *)vp;
   equi *eq = tp->eq;
 
-  if (tp->id == 0)
+  if (tp->id == 0) {
     printf("Digit 0\n");
+    eq->sched.reset(NBLOCKS);
+  }
   barrier(&eq->barry);
   eq->digit0(tp->id);
   barrier(&eq->barry);
   if (tp->id == 0) {
     eq->xfull = eq->bfull = eq->hfull = 0;
     eq->showbsizes(0);
+    eq->sched.reset(NBUCKETS);
   }
   barrier(&eq->barry);
   for (u32 r = 1; r < WK; r++) {
@@ -617,6 +695,7 @@ void *worker(void *vp) {
       printf(" x%d b%d h%d\n", eq->xfull, eq->bfull, eq->hfull);
       eq->xfull = eq->bfull = eq->hfull = 0;
       eq->showbsizes(r);
+      eq->sched.reset(NBUCKETS);
     }
     barrier(&eq->barry);
   }
@@ -9,6 +9,7 @@ include 'INCLUDE\win64a.inc'
 include 'params.inc'
 include 'struct_eh.inc'
 include 'macro_eh.asm'
+include 'macro_blake2b_avx2.asm'
 
 section '.text' code readable executable align 64
 
@@ -1,2 +1,3 @@
 ./fasm -m 1280000 equihash_avx1.asm
 ./fasm -m 1280000 equihash_avx2.asm
+./fasm -m 1280000 equihash_avx512.asm
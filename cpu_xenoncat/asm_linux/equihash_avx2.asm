@@ -6,6 +6,7 @@ include "struct.inc"
 include "params.inc"
 include "struct_eh.inc"
 include "macro_eh.asm"
+include "macro_blake2b_avx2.asm"
 
 section '.text' executable align 64
 include "proc_ehprepare_avx2.asm"
@@ -0,0 +1,17 @@
+format elf64
+public EhPrepare as 'EhPrepareAVX512'
+public EhSolver as 'EhSolverAVX512'
+
+include "struct.inc"
+include "params.inc"
+include "struct_eh.inc"
+include "macro_eh.asm"
+;AVX2 solver with the AVX-512VL Blake2b; the bucket layout is unchanged
+include "macro_blake2b_avx512.asm"
+
+section '.text' executable align 64
+include "proc_ehprepare_avx2.asm"
+include "proc_ehsolver_avx2.asm"
+
+section '.data' writeable align 64
+include "data_blake2b.asm"
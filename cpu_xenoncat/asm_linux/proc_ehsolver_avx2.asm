@@ -1,5 +1,3 @@
-include "macro_blake2b_avx2.asm"
-
 macro RecordRdtsc
 {
 rdtsc
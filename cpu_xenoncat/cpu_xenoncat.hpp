@@ -17,10 +17,11 @@ struct cpu_xenoncat
 
 	std::string getname() 
 	{ 
-		if (use_opt) return "CPU-XENONCAT-AVX2";
+		if (use_opt >= 2) return "CPU-XENONCAT-AVX512";
+		else if (use_opt) return "CPU-XENONCAT-AVX2";
 		else return "CPU-XENONCAT-AVX";
 	}
 
 	void *memory_alloc, *memory;
-	int use_opt;
+	int use_opt; // 0 = AVX, 1 = AVX2, 2 = AVX-512
 };
\ No newline at end of file
@@ -30,6 +30,9 @@ extern "C"
 	void EhPrepareAVX2(void *context, void *input);
 	int32_t EhSolverAVX2(void *context, uint32_t nonce);
 
+	void EhPrepareAVX512(void *context, void *input);
+	int32_t EhSolverAVX512(void *context, uint32_t nonce);
+
 #else
 	typedef void(__fastcall *_EhPrepare)(void*, void*);
 	_EhPrepare EhPrepare;
@@ -37,10 +40,11 @@ extern "C"
 	typedef int32_t(__fastcall *_EhSolver)(void*, uint32_t);
 	_EhSolver EhSolver;
 
-	void init_library(int use_avx2)
+	void init_library(int use_opt)
 	{
 		HMODULE hmod;
-		if (use_avx2) hmod = LoadLibraryA("xenoncat_AVX2.dll");
+		if (use_opt >= 2) hmod = LoadLibraryA("xenoncat_AVX512.dll");
+		else if (use_opt) hmod = LoadLibraryA("xenoncat_AVX2.dll");
 		else hmod = LoadLibraryA("xenoncat_AVX.dll");
 		EhPrepare = (_EhPrepare)GetProcAddress(hmod, "EhPrepare");
 		EhSolver = (_EhSolver)GetProcAddress(hmod, "EhSolver");
@@ -92,7 +96,12 @@ void cpu_xenoncat::solve(const char *tequihash_header,
 	EhPrepare(device_context.memory, (void *)context);
 	numsolutions = EhSolver(device_context.memory, *(uint32_t *)(context + 136));
 #else
-	if (device_context.use_opt)
+	if (device_context.use_opt >= 2)
+	{
+		EhPrepareAVX512(device_context.memory, (void *)context);
+		numsolutions = EhSolverAVX512(device_context.memory, *(uint32_t *)(context + 136));
+	}
+	else if (device_context.use_opt)
 	{
 		EhPrepareAVX2(device_context.memory, (void *)context);
 		numsolutions = EhSolverAVX2(device_context.memory, *(uint32_t *)(context + 136));
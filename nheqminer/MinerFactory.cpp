@@ -4,6 +4,7 @@
 
 extern int use_avx;
 extern int use_avx2;
+extern int use_avx512;
 extern int solver1927_threads;
 
 
@@ -48,7 +49,7 @@ std::vector<ISolver *> MinerFactory::GenerateSolvers(int cpu_threads, int cuda_c
 	if (solver1927_threads == 0) {
 		for (int i = 0; i < cpu_threads; ++i)
 		{
-			solversPointers.push_back(GenCPUSolver(use_avx2));
+			solversPointers.push_back(GenCPUSolver(use_avx512 ? 2 : use_avx2));
 		}
 	}
 
@@ -1,6 +1,9 @@
 #include <iostream>
 #include <chrono>
 #include <mutex>
+#include <atomic>
+#include <vector>
+#include <string>
 #include <boost/asio.hpp>
 #include <boost/bind.hpp>
 #include <boost/log/trivial.hpp>
@@ -9,6 +12,7 @@
 
 #include "api.hpp"
 #include "speed.hpp"
+#include "energy.hpp"
 
 
 API::API(std::shared_ptr<boost::asio::io_service> io_service)
@@ -144,7 +148,17 @@ bool Client::Parse(const std::string& request)
 		ss << "\"speed_ips\":" << speed.GetHashSpeed() << ",";
 		ss << "\"speed_sps\":" << speed.GetSolutionSpeed() << ",";
 		ss << "\"accepted_per_minute\":" << accepted << ",";
-		ss << "\"rejected_per_minute\":" << (allshares - accepted);
+		ss << "\"rejected_per_minute\":" << (allshares - accepted) << ",";
+		ss << "\"power_w\":" << energy.GetPower() << ",";
+		ss << "\"energy_j\":" << energy.GetJoules() << ",";
+		ss << "\"sols_per_joule\":" << energy.GetSolsPerJoule() << ",";
+		ss << "\"power_target_w\":" << energy.GetPowerTarget() << ",";
+		ss << "\"active_workers\":" << energy.GetActiveWorkers() << ",";
+		ss << "\"pacing_pct\":" << energy.GetPacingPct() << ",";
+		ss << "\"workers_sols_per_joule\":[";
+		for (int i = 0; i < energy.GetWorkers(); ++i)
+			ss << (i ? "," : "") << energy.GetWorkerSolsPerJoule(i);
+		ss << "]";
 		ss << "},\"error\":null}";
 	}
 	else
@@ -0,0 +1,273 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <boost/log/trivial.hpp>
+
+#include "utilstrencodings.h"
+#include "libstratum/ZcashStratum.h"
+#include "batchsolve.hpp"
+
+#ifdef WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <unistd.h>
+#endif
+
+#define BOOST_LOG_CUSTOM(sev) BOOST_LOG_TRIVIAL(sev) << "batch | "
+
+
+// The original stdout once BatchSolve_ReserveStdout moved fd 1 to stderr
+static FILE* solution_stdout = nullptr;
+
+
+// Hands inputs out in file order and writes results back in the same order.
+// Workers never get more than the window ahead of the oldest unwritten input,
+// which bounds the results held back for reordering.
+class BatchQueue
+{
+	std::istream& m_in;
+	FILE* m_out;
+	bool m_hex;
+	uint64_t m_window;
+
+	std::mutex m_mutex;
+	std::condition_variable m_written;
+	uint64_t m_next_read;
+	uint64_t m_next_write;
+	uint64_t m_line;
+	bool m_eof;
+	bool m_failed;
+	std::map<uint64_t, std::vector<std::string>> m_done;
+	uint64_t m_solutions;
+
+	bool Read(unsigned char* input)
+	{
+		if (!m_hex)
+		{
+			m_in.read((char*)input, BATCHSOLVE_INPUT_BYTES);
+			if (m_in.gcount() == BATCHSOLVE_INPUT_BYTES) return true;
+			if (m_in.gcount() != 0)
+			{
+				BOOST_LOG_CUSTOM(error) << "Input ends with a partial record of " << m_in.gcount() << " bytes";
+				m_failed = true;
+			}
+			return false;
+		}
+
+		std::string line;
+		while (std::getline(m_in, line))
+		{
+			++m_line;
+			if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+			std::vector<unsigned char> data = ParseHex(line);
+			if (data.size() != BATCHSOLVE_INPUT_BYTES)
+			{
+				BOOST_LOG_CUSTOM(error) << "Line " << m_line << ": expected " << BATCHSOLVE_INPUT_BYTES
+					<< " hex bytes, got " << data.size();
+				m_failed = true;
+				return false;
+			}
+			memcpy(input, data.data(), BATCHSOLVE_INPUT_BYTES);
+			return true;
+		}
+		return false;
+	}
+
+public:
+	BatchQueue(std::istream& in, FILE* out, bool hex, uint64_t window)
+		: m_in(in), m_out(out), m_hex(hex), m_window(window), m_next_read(0), m_next_write(0),
+		m_line(0), m_eof(false), m_failed(false), m_solutions(0) {}
+
+	// false once the input is exhausted or the batch failed
+	bool Next(uint64_t& index, unsigned char* input)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_written.wait(lock, [this] { return m_eof || m_failed || m_next_read < m_next_write + m_window; });
+		if (m_eof || m_failed) return false;
+		if (!Read(input))
+		{
+			m_eof = true;
+			m_written.notify_all();
+			return false;
+		}
+		index = m_next_read++;
+		return true;
+	}
+
+	void Complete(uint64_t index, std::vector<std::string>& solutions)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_done[index].swap(solutions);
+		for (auto it = m_done.begin(); it != m_done.end() && it->first == m_next_write; it = m_done.erase(it))
+		{
+			for (const std::string& solution : it->second)
+				fprintf(m_out, "%llu %s\n", (unsigned long long)it->first, solution.c_str());
+			m_solutions += it->second.size();
+			++m_next_write;
+		}
+		m_written.notify_all();
+	}
+
+	// A solver gave up on an input: nothing after it can be written in order
+	void Fail()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_failed = true;
+		m_written.notify_all();
+	}
+
+	bool Failed() { return m_failed; }
+	uint64_t GetWritten() { return m_next_write; }
+	uint64_t GetSolutions() { return m_solutions; }
+};
+
+
+static void batch_thread(int tid, ISolver *solver, BatchQueue& queue)
+{
+	BOOST_LOG_TRIVIAL(debug) << "Thread #" << tid << " started (" << solver->getname() << ")";
+
+	std::vector<std::string> solutions;
+	std::function<void(const std::vector<uint32_t>&, size_t, const unsigned char*)> solutionFound =
+		[&solutions](const std::vector<uint32_t>& index_vector, size_t cbitlen, const unsigned char* compressed_sol)
+	{
+		if (compressed_sol)
+			solutions.push_back(HexStr(compressed_sol, compressed_sol + cbitlen));
+		else
+			solutions.push_back(HexStr(GetMinimalFromIndices(index_vector, cbitlen)));
+	};
+	std::function<bool()> cancel = []() { return false; };
+	std::function<void(void)> hashDone = []() {};
+
+	try
+	{
+		solver->start();
+
+		unsigned char input[BATCHSOLVE_INPUT_BYTES];
+		uint64_t index;
+		while (queue.Next(index, input))
+		{
+			solutions.clear();
+			solver->solve((const char*)input, BATCHSOLVE_HEADER_BYTES,
+				(const char*)input + BATCHSOLVE_HEADER_BYTES, BATCHSOLVE_INPUT_BYTES - BATCHSOLVE_HEADER_BYTES,
+				cancel, solutionFound, hashDone);
+			queue.Complete(index, solutions);
+		}
+
+		solver->stop();
+	}
+	catch (const std::runtime_error &e)
+	{
+		BOOST_LOG_CUSTOM(error) << "Thread #" << tid << ": " << e.what();
+		queue.Fail();
+	}
+
+	BOOST_LOG_TRIVIAL(debug) << "Thread #" << tid << " ended (" << solver->getname() << ")";
+}
+
+
+bool Solvers_doBatchSolve(const std::string& input, bool hex, const std::string& output,
+	const std::vector<ISolver *> &solvers)
+{
+	std::vector<char> buffer(BATCHSOLVE_READ_BUFFER);
+	std::ifstream infile;
+	std::istream* in = &std::cin;
+	if (input != "-")
+	{
+		infile.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+		infile.open(input, hex ? std::ios::in : std::ios::in | std::ios::binary);
+		if (!infile)
+		{
+			BOOST_LOG_CUSTOM(error) << "Cannot open input " << input;
+			return false;
+		}
+		in = &infile;
+	}
+#ifdef WIN32
+	else if (!hex)
+		_setmode(_fileno(stdin), _O_BINARY);
+#endif
+
+	FILE* out = solution_stdout;
+	bool to_file = !output.empty() && output != "-";
+	if (to_file)
+	{
+		out = fopen(output.c_str(), "w");
+		if (!out)
+		{
+			BOOST_LOG_CUSTOM(error) << "Cannot open output " << output;
+			return false;
+		}
+	}
+	else if (!out)
+	{
+		BOOST_LOG_CUSTOM(error) << "Stdout was not reserved for the solutions";
+		return false;
+	}
+
+	int nThreads = solvers.size();
+	BatchQueue queue(*in, out, hex, (uint64_t)nThreads * BATCHSOLVE_WINDOW_PER_WORKER);
+
+	for (ISolver* solver : solvers)
+		BOOST_LOG_TRIVIAL(info) << "Batch worker (" << solver->getname() << ") " << solver->getdevinfo();
+	BOOST_LOG_TRIVIAL(info) << "Solving " << (hex ? "hex" : "binary") << " inputs from "
+		<< (input == "-" ? "stdin" : input) << "...";
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	std::vector<std::thread> bthreads;
+	for (int i = 0; i < nThreads; ++i)
+		bthreads.push_back(std::thread(batch_thread, i, solvers[i], std::ref(queue)));
+	for (std::thread& t : bthreads)
+		t.join();
+	bool written = fflush(out) == 0 && !ferror(out);
+	if (to_file)
+		written = fclose(out) == 0 && written;
+
+	auto end = std::chrono::high_resolution_clock::now();
+	uint64_t msec = std::max<uint64_t>(1, std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count());
+
+	BOOST_LOG_TRIVIAL(info) << "Batch " << (queue.Failed() ? "stopped" : "done") << "!";
+	BOOST_LOG_TRIVIAL(info) << "Total time : " << msec << " ms";
+	BOOST_LOG_TRIVIAL(info) << "Total inputs: " << queue.GetWritten();
+	BOOST_LOG_TRIVIAL(info) << "Total solutions found: " << queue.GetSolutions();
+	BOOST_LOG_TRIVIAL(info) << "Speed: " << ((double)queue.GetWritten() * 1000 / (double)msec) << " I/s";
+	BOOST_LOG_TRIVIAL(info) << "Speed: " << ((double)queue.GetSolutions() * 1000 / (double)msec) << " Sols/s";
+
+	if (!written)
+	{
+		BOOST_LOG_CUSTOM(error) << "Writing the solutions failed";
+		return false;
+	}
+	return !queue.Failed();
+}
+
+
+bool BatchSolve_ReserveStdout()
+{
+	// Solvers print progress on stdout through iostreams and printf alike, so
+	// fd 1 itself is pointed at stderr and the solutions keep a copy of it
+	fflush(stdout);
+#ifdef WIN32
+	int fd = _dup(_fileno(stdout));
+	if (fd < 0 || _dup2(_fileno(stderr), _fileno(stdout)) != 0)
+		return false;
+	solution_stdout = _fdopen(fd, "w");
+#else
+	int fd = dup(STDOUT_FILENO);
+	if (fd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0)
+		return false;
+	solution_stdout = fdopen(fd, "w");
+#endif
+	return solution_stdout != nullptr;
+}
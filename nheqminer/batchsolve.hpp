@@ -0,0 +1,19 @@
+#pragma once
+
+#define BATCHSOLVE_INPUT_BYTES 140 // serialised header without nonce, then the 32-byte nonce
+#define BATCHSOLVE_HEADER_BYTES 108
+#define BATCHSOLVE_WINDOW_PER_WORKER 4 // inputs handed out ahead of the oldest unwritten one
+#define BATCHSOLVE_READ_BUFFER (1 << 20)
+
+class ISolver;
+
+// Offline solving of a file of Equihash inputs ("-" = stdin), either raw
+// 140-byte records or one hex record per line. Inputs are spread over all
+// solvers and every solution is written as "<input index> <hex solution>"
+// in input order ("-" = stdout). Returns false on bad input or a solver error.
+bool Solvers_doBatchSolve(const std::string& input, bool hex, const std::string& output,
+	const std::vector<ISolver *> &solvers);
+
+// Batch mode keeps stdout for the solutions: call before anything prints.
+// Everything else written to stdout from then on goes to stderr.
+bool BatchSolve_ReserveStdout();
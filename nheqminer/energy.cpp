@@ -0,0 +1,259 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <boost/log/trivial.hpp>
+
+#include "energy.hpp"
+
+#define BOOST_LOG_CUSTOM(sev) BOOST_LOG_TRIVIAL(sev) << "energy | "
+
+
+Energy::Energy()
+	: m_last_sample(std::chrono::steady_clock::now()), m_last_regulate(m_last_sample),
+	m_joules(0), m_dram_joules(0), m_power(0), m_target(0), m_active_workers(0), m_pacing_pct(0) {}
+Energy::~Energy() { }
+
+bool Energy::ReadCounter(const std::string& path, uint64_t& value)
+{
+	std::ifstream in(path);
+	return (bool)(in >> value);
+}
+
+bool Energy::Init(const std::string& root)
+{
+	namespace fs = boost::filesystem;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_root = root;
+	m_domains.clear();
+
+	boost::system::error_code ec;
+	if (!fs::is_directory(root, ec))
+	{
+		BOOST_LOG_CUSTOM(info) << "No powercap tree at " << root << ", energy telemetry disabled";
+		return false;
+	}
+
+	// Zones are intel-rapl:<pkg> with sub-zones intel-rapl:<pkg>:<n>; only the
+	// package zones and the DRAM sub-zones are summed so nothing is counted twice.
+	// intel-rapl-mmio:<pkg> reports the same package again and is skipped.
+	std::vector<std::string> zones;
+	for (fs::directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec))
+	{
+		std::string zone = it->path().filename().string();
+		if (zone.compare(0, 11, "intel-rapl:") == 0)
+			zones.push_back(zone);
+	}
+	std::sort(zones.begin(), zones.end());
+
+	for (const std::string& zone : zones)
+	{
+		std::string dir = root + "/" + zone;
+		std::string name;
+		std::ifstream name_in(dir + "/name");
+		std::getline(name_in, name);
+
+		bool package = std::count(zone.begin(), zone.end(), ':') == 1 && name.compare(0, 7, "package") == 0;
+		bool dram = name == "dram";
+		if (!package && !dram) continue;
+
+		Domain d;
+		d.name = name;
+		d.energy_path = dir + "/energy_uj";
+		if (!ReadCounter(dir + "/max_energy_range_uj", d.max_range))
+			d.max_range = 0;
+		if (!ReadCounter(d.energy_path, d.last))
+		{
+			BOOST_LOG_CUSTOM(warning) << "Cannot read " << d.energy_path << " (permissions?)";
+			continue;
+		}
+		m_domains.push_back(d);
+	}
+
+	m_last_sample = m_last_regulate = std::chrono::steady_clock::now();
+	m_joules = m_dram_joules = m_power = 0;
+
+	if (m_domains.empty())
+	{
+		BOOST_LOG_CUSTOM(info) << "No readable RAPL package/DRAM counters under " << root;
+		return false;
+	}
+
+	BOOST_LOG_CUSTOM(info) << "Using RAPL domains: " << GetDomainNames();
+	return true;
+}
+
+std::string Energy::GetDomainNames()
+{
+	std::stringstream ss;
+	for (size_t i = 0; i < m_domains.size(); ++i)
+		ss << (i ? ", " : "") << m_domains[i].name;
+	return ss.str();
+}
+
+void Energy::SetWorkers(int workers)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_worker_joules.assign(workers, 0);
+	m_worker_solutions.assign(workers, 0);
+	m_active_workers.store(workers);
+	m_pacing_pct.store(0);
+}
+
+void Energy::AddSolution(int worker)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (worker >= 0 && worker < (int)m_worker_solutions.size())
+		++m_worker_solutions[worker];
+}
+
+void Energy::SampleLocked(time_point now)
+{
+	double joules = 0, dram_joules = 0;
+	for (Domain& d : m_domains)
+	{
+		uint64_t value;
+		if (!ReadCounter(d.energy_path, value)) continue;
+		// counters wrap at max_energy_range_uj
+		uint64_t delta = value >= d.last ? value - d.last
+			: (d.max_range > d.last ? d.max_range - d.last + value : 0);
+		d.last = value;
+		joules += delta / 1e6;
+		if (d.name == "dram") dram_joules += delta / 1e6;
+	}
+
+	double seconds = std::chrono::duration<double>(now - m_last_sample).count();
+	if (seconds > 0) m_power = joules / seconds;
+	m_last_sample = now;
+	m_joules += joules;
+	m_dram_joules += dram_joules;
+
+	// attribute host energy evenly to the workers that were running
+	int active = std::min(m_active_workers.load(), (int)m_worker_joules.size());
+	for (int i = 0; i < active; ++i)
+		m_worker_joules[i] += joules / active;
+}
+
+void Energy::Sample(bool force)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_domains.empty()) return;
+	time_point now = std::chrono::steady_clock::now();
+	if (!force && now - m_last_sample < std::chrono::seconds(ENERGY_SAMPLE_SECONDS)) return;
+	SampleLocked(now);
+}
+
+double Energy::GetPower()
+{
+	Sample();
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_power;
+}
+
+double Energy::GetJoules()
+{
+	Sample();
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_joules;
+}
+
+double Energy::GetDramJoules()
+{
+	Sample();
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_dram_joules;
+}
+
+double Energy::GetSolsPerJoule()
+{
+	Sample();
+	std::lock_guard<std::mutex> lock(m_mutex);
+	uint64_t total = 0;
+	for (uint64_t s : m_worker_solutions) total += s;
+	return m_joules > 0 ? (double)total / m_joules : 0;
+}
+
+double Energy::GetWorkerSolsPerJoule(int worker)
+{
+	Sample();
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (worker < 0 || worker >= (int)m_worker_joules.size() || m_worker_joules[worker] <= 0) return 0;
+	return (double)m_worker_solutions[worker] / m_worker_joules[worker];
+}
+
+int Energy::GetWorkers()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_worker_joules.size();
+}
+
+void Energy::Regulate()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_domains.empty() || m_target <= 0) return;
+
+	time_point now = std::chrono::steady_clock::now();
+	if (now - m_last_regulate < std::chrono::seconds(ENERGY_REGULATE_SECONDS)) return;
+	m_last_regulate = now;
+	SampleLocked(now);
+
+	// Fine control by pacing solves; once pacing is maxed out park a worker and
+	// start again from full speed. Release in the opposite order.
+	int workers = m_worker_joules.size();
+	int active = m_active_workers.load();
+	int pacing = m_pacing_pct.load();
+	if (m_power > m_target * 1.03)
+	{
+		pacing += ENERGY_PACING_STEP_PCT;
+		if (pacing > ENERGY_PACING_MAX_PCT && active > 1)
+		{
+			--active;
+			pacing = 0;
+		}
+		pacing = std::min(pacing, ENERGY_PACING_MAX_PCT);
+	}
+	else if (m_power < m_target * 0.95)
+	{
+		if (pacing > 0)
+			pacing = std::max(pacing - ENERGY_PACING_STEP_PCT, 0);
+		else if (active < workers)
+			++active;
+	}
+	else return;
+
+	if (active != m_active_workers.load() || pacing != m_pacing_pct.load())
+		BOOST_LOG_CUSTOM(debug) << "Power " << m_power << " W, target " << m_target << " W: "
+			<< active << "/" << workers << " workers, pacing " << pacing << "%";
+	m_active_workers.store(active);
+	m_pacing_pct.store(pacing);
+}
+
+void Energy::Pace(std::chrono::steady_clock::duration solve_time)
+{
+	int pacing = m_pacing_pct.load();
+	if (pacing > 0)
+		std::this_thread::sleep_for(solve_time * pacing / 100);
+}
+
+void Energy::Reset()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	time_point now = std::chrono::steady_clock::now();
+	// re-read the counters so the next delta starts from now
+	for (Domain& d : m_domains)
+		ReadCounter(d.energy_path, d.last);
+	m_last_sample = m_last_regulate = now;
+	m_joules = m_dram_joules = m_power = 0;
+	std::fill(m_worker_joules.begin(), m_worker_joules.end(), 0);
+	std::fill(m_worker_solutions.begin(), m_worker_solutions.end(), 0);
+}
+
+
+Energy energy;
@@ -0,0 +1,73 @@
+#pragma once
+
+#define POWERCAP_DEFAULT_PATH "/sys/class/powercap"
+#define ENERGY_SAMPLE_SECONDS 1 // minimum spacing of counter reads
+#define ENERGY_REGULATE_SECONDS 5 // power cap controller period
+#define ENERGY_PACING_STEP_PCT 10 // idle time added per step, % of solve time
+#define ENERGY_PACING_MAX_PCT 100
+
+// RAPL energy telemetry (package + DRAM domains from the powercap sysfs tree)
+// and a power-capped operating mode that parks workers and paces solves.
+class Energy
+{
+	using time_point = std::chrono::steady_clock::time_point;
+
+	struct Domain
+	{
+		std::string name;
+		std::string energy_path;
+		uint64_t max_range;
+		uint64_t last;
+	};
+
+	std::string m_root;
+	std::vector<Domain> m_domains;
+	std::mutex m_mutex;
+
+	time_point m_last_sample;
+	time_point m_last_regulate;
+	double m_joules;
+	double m_dram_joules;
+	double m_power;
+
+	std::vector<double> m_worker_joules;
+	std::vector<uint64_t> m_worker_solutions;
+
+	double m_target;
+	std::atomic_int m_active_workers;
+	std::atomic_int m_pacing_pct;
+
+	bool ReadCounter(const std::string& path, uint64_t& value);
+	void SampleLocked(time_point now);
+
+public:
+	Energy();
+	virtual ~Energy();
+
+	bool Init(const std::string& root);
+	bool IsAvailable() { return !m_domains.empty(); }
+	std::string GetDomainNames();
+
+	void SetWorkers(int workers);
+	void AddSolution(int worker);
+
+	void Sample(bool force = false);
+	double GetPower();
+	double GetJoules();
+	double GetDramJoules();
+	double GetSolsPerJoule();
+	double GetWorkerSolsPerJoule(int worker);
+	int GetWorkers();
+
+	void SetPowerTarget(double watts) { m_target = watts; }
+	double GetPowerTarget() { return m_target; }
+	void Regulate();
+	bool IsWorkerActive(int worker) { return worker < m_active_workers.load(); }
+	int GetActiveWorkers() { return m_active_workers.load(); }
+	int GetPacingPct() { return m_pacing_pct.load(); }
+	void Pace(std::chrono::steady_clock::duration solve_time);
+
+	void Reset();
+};
+
+extern Energy energy;
@@ -0,0 +1,529 @@
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <new>
+#include <algorithm>
+#include <boost/log/trivial.hpp>
+
+#include "version.h"
+#include "streams.h"
+#include "libstratum/ZcashStratum.h"
+
+#include "jobbus.hpp"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#endif
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#endif
+
+#define BOOST_LOG_CUSTOM(sev) BOOST_LOG_TRIVIAL(sev) << "jobbus | "
+
+#define JOBBUS_MAGIC 0x7375626f6a716568ull // "heqjobus"
+#define JOBBUS_VERSION 1
+#define JOBBUS_READ_TRIES 100000
+
+// The segment is shared between processes, so every atomic in it has to be
+// address free (lock free) and the layout identical across builds.
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2, "job bus needs lock-free atomics");
+static_assert((JOBBUS_SOLUTION_SLOTS & (JOBBUS_SOLUTION_SLOTS - 1)) == 0, "solution slots must be a power of two");
+
+struct JobRecord
+{
+	uint64_t sequence;
+	uint32_t valid; // 0 = pause mining
+	uint32_t header_len;
+	uint8_t header[JOBBUS_HEADER_BYTES];
+	char job_id[JOBBUS_STRING_BYTES];
+	char time[JOBBUS_STRING_BYTES];
+	uint64_t nonce1_size;
+	uint8_t nonce2_space[32];
+	uint8_t nonce2_inc[32];
+	uint8_t target[32];
+	uint32_t clean;
+};
+
+struct SolutionRecord
+{
+	char job_id[JOBBUS_STRING_BYTES];
+	char time[JOBBUS_STRING_BYTES];
+	uint8_t nonce[32];
+	uint64_t nonce1_size;
+	uint32_t solution_len;
+	uint8_t solution[JOBBUS_SOLUTION_BYTES];
+};
+
+struct JobBus::Segment
+{
+	std::atomic<uint64_t> magic; // stored last by the owner
+	uint32_t version;
+	uint32_t owner_pid;
+	std::atomic<uint32_t> closed;
+	std::atomic<uint32_t> next_partition;
+
+	// Seqlock ring: a slot's seq is odd while the owner rewrites it
+	std::atomic<uint64_t> job_sequence;
+	std::atomic<uint32_t> job_futex; // bumped on every publish, attached processes wait on it
+	struct alignas(64) JobSlot
+	{
+		std::atomic<uint32_t> seq;
+		JobRecord job;
+	} jobs[JOBBUS_JOB_SLOTS];
+
+	// Bounded MPMC queue (Vyukov): a cell's seq says whose turn it is
+	alignas(64) std::atomic<uint64_t> enqueue_pos;
+	alignas(64) std::atomic<uint64_t> dequeue_pos;
+	struct alignas(64) SolutionCell
+	{
+		std::atomic<uint64_t> seq;
+		SolutionRecord solution;
+	} solutions[JOBBUS_SOLUTION_SLOTS];
+};
+
+
+static void CopyString(char* out, const std::string& in)
+{
+	size_t len = std::min(in.size(), (size_t)JOBBUS_STRING_BYTES - 1);
+	memcpy(out, in.data(), len);
+	out[len] = 0;
+}
+
+static void CopyString(std::string& out, const char* in)
+{
+	out.assign(in, strnlen(in, JOBBUS_STRING_BYTES));
+}
+
+
+JobBus::JobBus()
+	: m_segment(nullptr), m_owner(false), m_partition(0), m_seen_sequence(0),
+	m_last_attach(std::chrono::steady_clock::now()) {}
+JobBus::~JobBus() { Close(); }
+
+bool JobBus::Map(int fd, bool create)
+{
+#ifndef _WIN32
+	if (create && ftruncate(fd, sizeof(Segment)) != 0)
+	{
+		BOOST_LOG_CUSTOM(error) << "Cannot size shared memory " << m_name << ": " << strerror(errno);
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Segment))
+	{
+		BOOST_LOG_CUSTOM(error) << "Shared memory " << m_name << " has the wrong size (different build?)";
+		return false;
+	}
+	void* mem = mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (mem == MAP_FAILED)
+	{
+		BOOST_LOG_CUSTOM(error) << "Cannot map shared memory " << m_name << ": " << strerror(errno);
+		return false;
+	}
+	m_segment = static_cast<Segment*>(mem);
+	return true;
+#else
+	return false;
+#endif
+}
+
+void JobBus::Unmap()
+{
+#ifndef _WIN32
+	if (m_segment) munmap(m_segment, sizeof(Segment));
+#endif
+	m_segment = nullptr;
+}
+
+bool JobBus::OwnerAlive(const Segment* segment)
+{
+#ifndef _WIN32
+	// EPERM still means the process exists
+	return kill(segment->owner_pid, 0) == 0 || errno != ESRCH;
+#else
+	return false;
+#endif
+}
+
+bool JobBus::ExistingOwnerAlive(const std::string& name)
+{
+#ifndef _WIN32
+	int fd = shm_open(name.c_str(), O_RDWR, 0600);
+	if (fd < 0) return false;
+	struct stat st;
+	// A segment of another size is left over from a different build
+	bool alive = fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(Segment) && Map(fd, false);
+	close(fd);
+	if (alive)
+	{
+		alive = m_segment->magic.load(std::memory_order_acquire) == JOBBUS_MAGIC &&
+			!m_segment->closed.load(std::memory_order_acquire) && OwnerAlive(m_segment);
+		if (alive)
+			BOOST_LOG_CUSTOM(error) << "Job bus " << name << " is already owned by pid " << m_segment->owner_pid;
+		Unmap();
+	}
+	return alive;
+#else
+	return false;
+#endif
+}
+
+void JobBus::CheckOwner()
+{
+	// An owner that crashed never marks the segment closed
+	if (!OwnerAlive(m_segment))
+		m_segment->closed.store(1, std::memory_order_release);
+}
+
+bool JobBus::Create(const std::string& name)
+{
+#ifndef _WIN32
+	Close();
+	m_name = name;
+
+	// Never take the bus over from a live owner; a crashed owner leaves its
+	// segment behind, start from a fresh one then
+	if (ExistingOwnerAlive(name))
+		return false;
+	shm_unlink(name.c_str());
+	int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (fd < 0)
+	{
+		BOOST_LOG_CUSTOM(error) << "Cannot create shared memory " << name << ": " << strerror(errno);
+		return false;
+	}
+	bool mapped = Map(fd, true);
+	close(fd);
+	if (!mapped)
+	{
+		shm_unlink(name.c_str());
+		return false;
+	}
+
+	Segment* seg = new (m_segment) Segment();
+	seg->version = JOBBUS_VERSION;
+	seg->owner_pid = getpid();
+	seg->closed.store(0);
+	seg->next_partition.store(1);
+	seg->job_sequence.store(0);
+	seg->job_futex.store(0);
+	for (int i = 0; i < JOBBUS_JOB_SLOTS; ++i)
+		seg->jobs[i].seq.store(0);
+	seg->enqueue_pos.store(0);
+	seg->dequeue_pos.store(0);
+	for (uint64_t i = 0; i < JOBBUS_SOLUTION_SLOTS; ++i)
+		seg->solutions[i].seq.store(i);
+	seg->magic.store(JOBBUS_MAGIC, std::memory_order_release);
+
+	m_owner = true;
+	m_partition = 0;
+	BOOST_LOG_CUSTOM(info) << "Publishing jobs on " << name << " (" << sizeof(Segment) << " bytes)";
+	return true;
+#else
+	BOOST_LOG_CUSTOM(error) << "Shared-memory job bus is not supported on this platform";
+	return false;
+#endif
+}
+
+bool JobBus::Attach(const std::string& name)
+{
+#ifndef _WIN32
+	Close();
+	m_name = name;
+	m_last_attach = std::chrono::steady_clock::now();
+
+	int fd = shm_open(name.c_str(), O_RDWR, 0600);
+	if (fd < 0)
+	{
+		BOOST_LOG_CUSTOM(debug) << "No job bus at " << name << ": " << strerror(errno);
+		return false;
+	}
+	bool mapped = Map(fd, false);
+	close(fd);
+	if (!mapped) return false;
+
+	if (m_segment->magic.load(std::memory_order_acquire) != JOBBUS_MAGIC || m_segment->version != JOBBUS_VERSION ||
+		m_segment->closed.load())
+	{
+		BOOST_LOG_CUSTOM(debug) << "Job bus " << name << " is not ready";
+		Unmap();
+		return false;
+	}
+
+	m_partition = m_segment->next_partition.fetch_add(1);
+	if (m_partition >= JOBBUS_MAX_PARTITIONS)
+	{
+		BOOST_LOG_CUSTOM(error) << "Job bus " << name << " has no free nonce partition left";
+		Unmap();
+		return false;
+	}
+
+	m_owner = false;
+	m_seen_sequence = 0;
+	BOOST_LOG_CUSTOM(info) << "Attached to " << name << " (owner pid " << m_segment->owner_pid
+		<< "), nonce partition " << m_partition;
+	return true;
+#else
+	BOOST_LOG_CUSTOM(error) << "Shared-memory job bus is not supported on this platform";
+	return false;
+#endif
+}
+
+void JobBus::Close()
+{
+	if (!m_segment) return;
+#ifndef _WIN32
+	if (m_owner)
+	{
+		PublishJob(nullptr);
+		m_segment->closed.store(1, std::memory_order_release);
+		m_segment->job_futex.fetch_add(1, std::memory_order_release);
+#ifdef __linux__
+		syscall(SYS_futex, &m_segment->job_futex, FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+#endif
+		shm_unlink(m_name.c_str());
+	}
+#endif
+	Unmap();
+	m_owner = false;
+}
+
+void JobBus::PublishJob(const ZcashJob* job)
+{
+	if (!m_segment || !m_owner) return;
+	Segment* seg = m_segment;
+
+	JobRecord record;
+	memset(&record, 0, sizeof(record));
+	record.sequence = seg->job_sequence.load(std::memory_order_relaxed) + 1;
+	if (job)
+	{
+		CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+		ss << job->header;
+		if (ss.size() > JOBBUS_HEADER_BYTES)
+		{
+			BOOST_LOG_CUSTOM(error) << "Header of job #" << job->job << " does not fit the bus (" << ss.size() << " bytes)";
+			return;
+		}
+		record.valid = 1;
+		record.header_len = ss.size();
+		memcpy(record.header, &ss[0], ss.size());
+		CopyString(record.job_id, job->job);
+		CopyString(record.time, job->time);
+		record.nonce1_size = job->nonce1Size;
+		uint256 value = ArithToUint256(job->nonce2Space);
+		memcpy(record.nonce2_space, value.begin(), 32);
+		value = ArithToUint256(job->nonce2Inc);
+		memcpy(record.nonce2_inc, value.begin(), 32);
+		value = ArithToUint256(job->serverTarget);
+		memcpy(record.target, value.begin(), 32);
+		record.clean = job->clean;
+	}
+
+	// Single writer: the slot is odd while it is rewritten, readers retry
+	Segment::JobSlot& slot = seg->jobs[record.sequence % JOBBUS_JOB_SLOTS];
+	uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+	slot.seq.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	memcpy(&slot.job, &record, sizeof(record));
+	slot.seq.store(seq + 2, std::memory_order_release);
+	seg->job_sequence.store(record.sequence, std::memory_order_release);
+
+	seg->job_futex.fetch_add(1, std::memory_order_release);
+#ifdef __linux__
+	syscall(SYS_futex, &seg->job_futex, FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+#endif
+	BOOST_LOG_CUSTOM(debug) << "Published " << (job ? "job #" + job->job : std::string("pause")) << " as #" << record.sequence;
+}
+
+int JobBus::DrainSolutions(ZcashMiner& miner)
+{
+	if (!m_segment || !m_owner) return 0;
+	Segment* seg = m_segment;
+
+	int drained = 0;
+	uint64_t pos = seg->dequeue_pos.load(std::memory_order_relaxed);
+	while (true)
+	{
+		Segment::SolutionCell& cell = seg->solutions[pos & (JOBBUS_SOLUTION_SLOTS - 1)];
+		int64_t diff = (int64_t)cell.seq.load(std::memory_order_acquire) - (int64_t)(pos + 1);
+		if (diff < 0) break; // empty
+		if (diff > 0)
+		{
+			pos = seg->dequeue_pos.load(std::memory_order_relaxed);
+			continue;
+		}
+		if (!seg->dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			continue;
+
+		const SolutionRecord& rec = cell.solution;
+		uint256 nonce;
+		memcpy(nonce.begin(), rec.nonce, 32);
+		std::string jobid, time;
+		CopyString(jobid, rec.job_id);
+		CopyString(time, rec.time);
+		std::vector<unsigned char> sol(rec.solution, rec.solution + std::min(rec.solution_len, (uint32_t)JOBBUS_SOLUTION_BYTES));
+		cell.seq.store(pos + JOBBUS_SOLUTION_SLOTS, std::memory_order_release);
+
+		EquihashSolution solution{ nonce, sol, time, (size_t)rec.nonce1_size };
+		miner.submitSolution(solution, jobid);
+		++drained;
+		pos = seg->dequeue_pos.load(std::memory_order_relaxed);
+	}
+	return drained;
+}
+
+bool JobBus::NextJob(ZcashJob*& job, int timeout_ms)
+{
+	job = nullptr;
+	if (!m_segment || m_segment->closed.load(std::memory_order_acquire))
+	{
+		// Owner went away: pause once, then look for a new owner every so often
+		bool was_open = m_segment != nullptr;
+		Unmap();
+		if (was_open)
+		{
+			BOOST_LOG_CUSTOM(warning) << "Job bus owner closed " << m_name << ", waiting for a new one";
+			return true;
+		}
+		if (std::chrono::steady_clock::now() - m_last_attach < std::chrono::seconds(JOBBUS_REATTACH_SECONDS) || !Attach(m_name))
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+			return false;
+		}
+	}
+	Segment* seg = m_segment;
+
+	uint32_t futex = seg->job_futex.load(std::memory_order_acquire);
+	uint64_t sequence = seg->job_sequence.load(std::memory_order_acquire);
+	if (sequence == m_seen_sequence)
+	{
+#ifdef __linux__
+		struct timespec ts;
+		ts.tv_sec = timeout_ms / 1000;
+		ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+		syscall(SYS_futex, &seg->job_futex, FUTEX_WAIT, futex, &ts, nullptr, 0);
+#else
+		std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+#endif
+		sequence = seg->job_sequence.load(std::memory_order_acquire);
+		if (sequence == m_seen_sequence)
+		{
+			CheckOwner();
+			return false;
+		}
+	}
+
+	JobRecord record;
+	for (int tries = 0; ; ++tries)
+	{
+		// An owner that died mid-write leaves the slot odd forever
+		if (tries > JOBBUS_READ_TRIES)
+		{
+			CheckOwner();
+			return false;
+		}
+		Segment::JobSlot& slot = seg->jobs[sequence % JOBBUS_JOB_SLOTS];
+		uint32_t before = slot.seq.load(std::memory_order_acquire);
+		if (before & 1)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		memcpy(&record, &slot.job, sizeof(record));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.seq.load(std::memory_order_relaxed) == before && record.sequence == sequence)
+			break;
+		// Torn or lapped by newer jobs: take the newest one instead
+		sequence = seg->job_sequence.load(std::memory_order_acquire);
+	}
+	m_seen_sequence = sequence;
+
+	if (!record.valid) return true;
+
+	ZcashJob* ret = new ZcashJob();
+	try
+	{
+		std::vector<unsigned char> headerData(record.header, record.header + record.header_len);
+		CDataStream ss(headerData, SER_NETWORK, PROTOCOL_VERSION);
+		ss >> ret->header;
+	}
+	catch (const std::ios_base::failure&)
+	{
+		BOOST_LOG_CUSTOM(error) << "Invalid header in job bus record #" << sequence;
+		delete ret;
+		return false;
+	}
+	CopyString(ret->job, record.job_id);
+	CopyString(ret->time, record.time);
+	ret->nonce1Size = record.nonce1_size;
+	uint256 value;
+	memcpy(value.begin(), record.nonce2_space, 32);
+	ret->nonce2Space = UintToArith256(value);
+	memcpy(value.begin(), record.nonce2_inc, 32);
+	ret->nonce2Inc = UintToArith256(value);
+	memcpy(value.begin(), record.target, 32);
+	ret->serverTarget = UintToArith256(value);
+	ret->clean = record.clean != 0;
+
+	// Our slice of the nonce space; the miner threads split it further in byte 19
+	if (ret->nonce1Size / 2 > JOBBUS_NONCE_PARTITION_BYTE)
+		BOOST_LOG_CUSTOM(warning) << "Extranonce covers the partition byte, processes may overlap";
+	else
+		*(ret->header.nNonce.begin() + JOBBUS_NONCE_PARTITION_BYTE) = (unsigned char)m_partition;
+
+	job = ret;
+	return true;
+}
+
+bool JobBus::PushSolution(const EquihashSolution& solution, const std::string& jobid)
+{
+	if (!m_segment || m_owner) return false;
+	Segment* seg = m_segment;
+
+	if (solution.solution.size() > JOBBUS_SOLUTION_BYTES)
+	{
+		BOOST_LOG_CUSTOM(error) << "Solution of " << solution.solution.size() << " bytes does not fit the bus";
+		return false;
+	}
+
+	uint64_t pos = seg->enqueue_pos.load(std::memory_order_relaxed);
+	Segment::SolutionCell* cell;
+	while (true)
+	{
+		cell = &seg->solutions[pos & (JOBBUS_SOLUTION_SLOTS - 1)];
+		int64_t diff = (int64_t)cell->seq.load(std::memory_order_acquire) - (int64_t)pos;
+		if (diff == 0)
+		{
+			if (seg->enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if (diff < 0)
+		{
+			BOOST_LOG_CUSTOM(warning) << "Solution queue full, dropping solution for job #" << jobid;
+			return false;
+		}
+		else
+			pos = seg->enqueue_pos.load(std::memory_order_relaxed);
+	}
+
+	SolutionRecord& rec = cell->solution;
+	CopyString(rec.job_id, jobid);
+	CopyString(rec.time, solution.time);
+	memcpy(rec.nonce, solution.nonce.begin(), 32);
+	rec.nonce1_size = solution.nonce1size;
+	rec.solution_len = solution.solution.size();
+	memcpy(rec.solution, solution.solution.data(), solution.solution.size());
+	cell->seq.store(pos + 1, std::memory_order_release);
+	return true;
+}
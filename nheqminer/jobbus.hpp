@@ -0,0 +1,57 @@
+#pragma once
+
+#define JOBBUS_DEFAULT_NAME "/nheqminer-jobbus"
+#define JOBBUS_JOB_SLOTS 4 // seqlock ring; readers copy the newest slot while the next one is written
+#define JOBBUS_SOLUTION_SLOTS 64 // power of two
+#define JOBBUS_HEADER_BYTES 256 // serialised CBlockHeader, nonce and solution empty
+#define JOBBUS_STRING_BYTES 64
+#define JOBBUS_SOLUTION_BYTES 1344
+#define JOBBUS_MAX_PARTITIONS 256 // nonce byte 18 tells the processes apart, the owner is 0
+#define JOBBUS_NONCE_PARTITION_BYTE 18
+#define JOBBUS_REATTACH_SECONDS 1
+
+struct ZcashJob;
+struct EquihashSolution;
+class ZcashMiner;
+
+// Shared-memory job and solution bus for several miner processes on one host.
+// The owner process keeps the stratum connection and publishes every job into a
+// seqlock ring; attached (solver-only) processes mine a nonce partition of it
+// and hand candidate solutions back through a bounded lock-free queue.
+class JobBus
+{
+	struct Segment;
+
+	std::string m_name;
+	Segment* m_segment;
+	bool m_owner;
+	int m_partition;
+	uint64_t m_seen_sequence;
+	std::chrono::steady_clock::time_point m_last_attach;
+
+	bool Map(int fd, bool create);
+	void Unmap();
+	static bool OwnerAlive(const Segment* segment);
+	bool ExistingOwnerAlive(const std::string& name);
+	void CheckOwner();
+
+public:
+	JobBus();
+	virtual ~JobBus();
+
+	bool Create(const std::string& name);
+	bool Attach(const std::string& name);
+	void Close();
+
+	bool IsOpen() { return m_segment != nullptr; }
+	bool IsOwner() { return m_owner; }
+	int GetPartition() { return m_partition; }
+
+	// Owner side
+	void PublishJob(const ZcashJob* job); // nullptr pauses the attached processes
+	int DrainSolutions(ZcashMiner& miner);
+
+	// Attached side: true when a newer job was read, job is nullptr for a pause
+	bool NextJob(ZcashJob*& job, int timeout_ms);
+	bool PushSolution(const EquihashSolution& solution, const std::string& jobid);
+};
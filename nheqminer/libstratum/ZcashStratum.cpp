@@ -16,6 +16,7 @@
 #include <boost/log/trivial.hpp>
 #include <boost/circular_buffer.hpp>
 #include "speed.hpp"
+#include "energy.hpp"
 
 #ifdef WIN32
 #include <Windows.h>
@@ -78,20 +79,35 @@ void EhIndexToArray(const eh_index i, unsigned char* array)
 }
 
 
-std::vector<unsigned char> GetMinimalFromIndices(std::vector<eh_index> indices,
-	size_t cBitLen)
+void GetMinimalFromIndices(const std::vector<eh_index>& indices,
+	size_t cBitLen, std::vector<unsigned char>& minimal)
 {
 	assert(((cBitLen + 1) + 7) / 8 <= sizeof(eh_index));
 	size_t lenIndices{ indices.size()*sizeof(eh_index) };
 	size_t minLen{ (cBitLen + 1)*lenIndices / (8 * sizeof(eh_index)) };
 	size_t bytePad{ sizeof(eh_index) - ((cBitLen + 1) + 7) / 8 };
-	std::vector<unsigned char> array(lenIndices);
+	// 2^9 indices (k = 9) is the largest proof in use, bigger ones go to the heap
+	unsigned char stack_array[512 * sizeof(eh_index)];
+	std::vector<unsigned char> heap_array;
+	unsigned char* array = stack_array;
+	if (lenIndices > sizeof(stack_array)) {
+		heap_array.resize(lenIndices);
+		array = heap_array.data();
+	}
 	for (int i = 0; i < indices.size(); i++) {
-		EhIndexToArray(indices[i], array.data() + (i*sizeof(eh_index)));
+		EhIndexToArray(indices[i], array + (i*sizeof(eh_index)));
 	}
-	std::vector<unsigned char> ret(minLen);
-	CompressArray(array.data(), lenIndices,
-		ret.data(), minLen, cBitLen + 1, bytePad);
+	minimal.resize(minLen);
+	CompressArray(array, lenIndices,
+		minimal.data(), minLen, cBitLen + 1, bytePad);
+}
+
+
+std::vector<unsigned char> GetMinimalFromIndices(const std::vector<eh_index>& indices,
+	size_t cBitLen)
+{
+	std::vector<unsigned char> ret;
+	GetMinimalFromIndices(indices, cBitLen, ret);
 	return ret;
 }
 
@@ -191,63 +207,85 @@ void static ZcashMinerThread(ZcashMiner* miner, int size, int pos, ISolver *solv
 			char *tequihash_header = (char *)&ss[0];
 			unsigned int tequihash_header_len = ss.size();
 
+			// Callbacks are built once per job and handed to the solver through
+			// std::ref, so a solve does not heap-allocate copies of them
+			uint256 bNonce;
+
+			std::function<void(const std::vector<uint32_t>&, size_t, const unsigned char*)> solutionFound =
+				[&actualHeader, &bNonce, &actualTarget, &miner, pos, &actualJobId, &actualTime, &actualNonce1size]
+			(const std::vector<uint32_t>& index_vector, size_t cbitlen, const unsigned char* compressed_sol) 
+			{
+				actualHeader.nNonce = bNonce;
+				// Reuse the solution's storage: after the first solution of a job this allocates nothing
+				if (compressed_sol)
+				{
+					actualHeader.nSolution.assign(1344, 0);
+					for (size_t i = 0; i < cbitlen; ++i)
+						actualHeader.nSolution[i] = compressed_sol[i];
+				}
+				else
+					GetMinimalFromIndices(index_vector, cbitlen, actualHeader.nSolution);
+
+				speed.AddSolution();
+				energy.AddSolution(pos);
+
+				BOOST_LOG_CUSTOM(debug, pos) << "Checking solution against target...";
+
+				uint256 headerhash = actualHeader.GetHash();
+				if (UintToArith256(headerhash) > actualTarget) {
+					BOOST_LOG_CUSTOM(debug, pos) << "Too large: " << headerhash.ToString();
+					return;
+				}
+
+				// Found a solution
+				BOOST_LOG_CUSTOM(debug, pos) << "Found solution with header hash: " << headerhash.ToString();
+				EquihashSolution solution{ bNonce, actualHeader.nSolution, actualTime, actualNonce1size };
+				miner->submitSolution(solution, actualJobId);
+			};
+
+			std::function<bool()> cancelFun = [&cancelSolver]() {
+				return cancelSolver.load();
+			};
+
+			std::function<void(void)> hashDone = []() {
+				speed.AddHash();
+			};
+
             // Start working
             while (true) {
-				BOOST_LOG_CUSTOM(debug, pos) << "Running Equihash solver with nNonce = " << nonce.ToString();
+				// Power cap: a parked worker does not solve; it hands a new job (or a
+				// pause) to the outer loop and parks again on the new work
+				while (!energy.IsWorkerActive(pos) && !workReady.load() && !pauseMining.load())
+				{
+					if (!miner->minerThreadActive[pos])
+						throw boost::thread_interrupted();
+					std::this_thread::sleep_for(std::chrono::milliseconds(100));
+				}
+				if (!energy.IsWorkerActive(pos))
+					break;
 
-				auto bNonce = ArithToUint256(nonce);
+				BOOST_LOG_CUSTOM(debug, pos) << "Running Equihash solver with nNonce = " << nonce.ToString();
 
-				std::function<void(const std::vector<uint32_t>&, size_t, const unsigned char*)> solutionFound =
-					[&actualHeader, &bNonce, &actualTarget, &miner, pos, &actualJobId, &actualTime, &actualNonce1size]
-				(const std::vector<uint32_t>& index_vector, size_t cbitlen, const unsigned char* compressed_sol) 
-				{
-					actualHeader.nNonce = bNonce;
-					if (compressed_sol)
-					{
-						actualHeader.nSolution = std::vector<unsigned char>(1344);
-						for (size_t i = 0; i < cbitlen; ++i)
-							actualHeader.nSolution[i] = compressed_sol[i];
-					}
-					else
-						actualHeader.nSolution = GetMinimalFromIndices(index_vector, cbitlen);
-
-					speed.AddSolution();
-
-					BOOST_LOG_CUSTOM(debug, pos) << "Checking solution against target...";
-
-					uint256 headerhash = actualHeader.GetHash();
-					if (UintToArith256(headerhash) > actualTarget) {
-						BOOST_LOG_CUSTOM(debug, pos) << "Too large: " << headerhash.ToString();
-						return;
-					}
-
-					// Found a solution
-					BOOST_LOG_CUSTOM(debug, pos) << "Found solution with header hash: " << headerhash.ToString();
-					EquihashSolution solution{ bNonce, actualHeader.nSolution, actualTime, actualNonce1size };
-					miner->submitSolution(solution, actualJobId);
-				};
-
-				std::function<bool()> cancelFun = [&cancelSolver]() {
-					return cancelSolver.load();
-				};
-
-				std::function<void(void)> hashDone = []() {
-					speed.AddHash();
-				};
+				bNonce = ArithToUint256(nonce);
 
+				auto solveStart = std::chrono::steady_clock::now();
 				solver->solve(tequihash_header,
 					tequihash_header_len,
 					(const char*)bNonce.begin(),
 					bNonce.size(),
-					cancelFun,
-					solutionFound,
-					hashDone);
+					std::ref(cancelFun),
+					std::ref(solutionFound),
+					std::ref(hashDone));
+				auto solveTime = std::chrono::steady_clock::now() - solveStart;
 				
                 // Check for stop
 				if (!miner->minerThreadActive[pos])
 					throw boost::thread_interrupted();
                 //boost::this_thread::interruption_point();
 
+				// Power cap: pace the next solve
+				energy.Pace(solveTime);
+
 				// Update nonce
 				nonce += inc;
 
@@ -364,6 +402,7 @@ void ZcashMiner::start()
 
 	minerThreads = new std::thread[nThreads];
 	minerThreadActive = new bool[nThreads];
+	energy.SetWorkers(nThreads);
 
 	// sort solvers CPU, CUDA, OPENCL
 	std::sort(solvers.begin(), solvers.end(), [](const ISolver* a, const ISolver* b) { return a->GetType() < b->GetType(); });
@@ -426,6 +465,7 @@ void ZcashMiner::start()
     //}*/
 
 	speed.Reset();
+	energy.Reset();
 }
 
 
@@ -568,7 +608,7 @@ std::mutex benchmark_work;
 std::vector<uint256*> benchmark_nonces;
 std::atomic_int benchmark_solutions;
 
-bool benchmark_solve_equihash(const CBlock& pblock, const char *tequihash_header, unsigned int tequihash_header_len, ISolver *solver)
+bool benchmark_solve_equihash(int tid, const CBlock& pblock, const char *tequihash_header, unsigned int tequihash_header_len, ISolver *solver)
 {
 	benchmark_work.lock();
 	if (benchmark_nonces.empty())
@@ -583,7 +623,7 @@ bool benchmark_solve_equihash(const CBlock& pblock, const char *tequihash_header
 	BOOST_LOG_TRIVIAL(debug) << "Testing, nonce = " << nonce->ToString();
 
 	std::function<void(const std::vector<uint32_t>&, size_t, const unsigned char*)> solutionFound =
-		[&pblock, &nonce]
+		[&pblock, &nonce, tid]
 	(const std::vector<uint32_t>& index_vector, size_t cbitlen, const unsigned char* compressed_sol)
 	{
 		CBlockHeader hdr = pblock.GetBlockHeader();
@@ -601,8 +641,10 @@ bool benchmark_solve_equihash(const CBlock& pblock, const char *tequihash_header
 		BOOST_LOG_TRIVIAL(debug) << "Solution found, header = " << hdr.GetHash().ToString();
 
 		++benchmark_solutions;
+		energy.AddSolution(tid);
 	};
 
+	auto solveStart = std::chrono::steady_clock::now();
 	solver->solve(tequihash_header,
 		tequihash_header_len,
 		(const char*)nonce->begin(),
@@ -611,9 +653,23 @@ bool benchmark_solve_equihash(const CBlock& pblock, const char *tequihash_header
 		solutionFound,
 		[]() {}
 	);
+	auto solveTime = std::chrono::steady_clock::now() - solveStart;
 
 	delete nonce;
 
+	// Power cap: wait while parked (unless the work ran out), then pace
+	energy.Regulate();
+	while (!energy.IsWorkerActive(tid))
+	{
+		{
+			std::lock_guard<std::mutex> lock(benchmark_work);
+			if (benchmark_nonces.empty()) break;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		energy.Regulate();
+	}
+	energy.Pace(solveTime);
+
 	return true;
 }
 
@@ -633,7 +689,7 @@ int benchmark_thread(int tid, ISolver *solver)
 
 		solver->start();
 
-		while (benchmark_solve_equihash(pblock, tequihash_header, tequihash_header_len, solver)) {}
+		while (benchmark_solve_equihash(tid, pblock, tequihash_header, tequihash_header_len, solver)) {}
 
 		solver->stop();
 	}
@@ -679,6 +735,7 @@ void Solvers_doBenchmark(int hashes, const std::vector<ISolver *> &solvers) {
 
 	int nThreads = solvers.size();
 	std::thread* bthreads = new std::thread[nThreads];
+	energy.SetWorkers(nThreads);
 
 	benchmark_work.lock();
 	// bind benchmark threads
@@ -694,6 +751,7 @@ void Solvers_doBenchmark(int hashes, const std::vector<ISolver *> &solvers) {
 
 	BOOST_LOG_TRIVIAL(info) << "Benchmark starting... this may take several minutes, please wait...";
 
+	energy.Reset();
 	benchmark_work.unlock();
 	auto start = std::chrono::high_resolution_clock::now();
 
@@ -712,4 +770,15 @@ void Solvers_doBenchmark(int hashes, const std::vector<ISolver *> &solvers) {
 	BOOST_LOG_TRIVIAL(info) << "Total solutions found: " << benchmark_solutions;
 	BOOST_LOG_TRIVIAL(info) << "Speed: " << ((double)hashes_done * 1000 / (double)msec) << " I/s";
 	BOOST_LOG_TRIVIAL(info) << "Speed: " << ((double)benchmark_solutions * 1000 / (double)msec) << " Sols/s";
+
+	if (energy.IsAvailable())
+	{
+		energy.Sample(true);
+		double joules = energy.GetJoules();
+		BOOST_LOG_TRIVIAL(info) << "Energy: " << joules << " J (DRAM " << energy.GetDramJoules() << " J), "
+			<< (joules * 1000 / (double)msec) << " W average";
+		BOOST_LOG_TRIVIAL(info) << "Efficiency: " << energy.GetSolsPerJoule() << " Sols/J";
+		for (int i = 0; i < nThreads; ++i)
+			BOOST_LOG_TRIVIAL(info) << "Efficiency worker #" << i << ": " << energy.GetWorkerSolsPerJoule(i) << " Sols/J";
+	}
 }
@@ -22,6 +22,7 @@ using namespace json_spirit;
 
 extern int use_avx;
 extern int use_avx2;
+extern int use_avx512;
 
 struct EquihashSolution
 {
@@ -113,3 +114,8 @@ public:
 
 void Solvers_doBenchmark(int hashes, const std::vector<ISolver *> &solvers);
 
+// Compresses solution indices of cBitLen bits into the nSolution encoding
+std::vector<unsigned char> GetMinimalFromIndices(const std::vector<uint32_t>& indices, size_t cBitLen);
+// Same, into minimal's existing storage (no allocation once it is large enough)
+void GetMinimalFromIndices(const std::vector<uint32_t>& indices, size_t cBitLen, std::vector<unsigned char>& minimal);
+
@@ -20,6 +20,9 @@
 #include <bitset>
 
 #include "speed.hpp"
+#include "energy.hpp"
+#include "jobbus.hpp"
+#include "batchsolve.hpp"
 #include "api.hpp"
 
 #include <boost/log/core/core.hpp>
@@ -53,9 +56,12 @@ namespace keywords = boost::log::keywords;
 
 int use_avx = 0;
 int use_avx2 = 0;
+int use_avx512 = 0;
 int use_old_cuda = 0;
 int use_old_xmp = 0;
 int solver1927_threads = 0;
+int solver1927_probe = 0;
+int solver1927_smt = 0;
 
 // TODO move somwhere else
 MinerFactory *_MinerFactory = nullptr;
@@ -69,6 +75,14 @@ extern "C" void stratum_sigint_handler(int signum)
 	if (_MinerFactory) _MinerFactory->ClearAllSolvers();
 }
 
+// solver-only process attached to a job bus
+static std::atomic<bool> attachedRunning{ true };
+
+extern "C" void attached_sigint_handler(int signum)
+{
+	attachedRunning.store(false);
+}
+
 void print_help()
 {
 	std::cout << "Parameters: " << std::endl;
@@ -83,13 +97,22 @@ void print_help()
 	std::cout << "\t-a [port]\tLocal API port (default: 0 = do not bind)" << std::endl;
 	std::cout << "\t-d [level]\tDebug print level (0 = print all, 5 = fatal only, default: 2)" << std::endl;
 	std::cout << "\t-b [hashes]\tRun in benchmark mode (default: 200 iterations)" << std::endl;
+	std::cout << "\t-bi [file]\tSolve 140-byte binary inputs (header + nonce) from file, - = stdin" << std::endl;
+	std::cout << "\t-bx [file]\tSame with one hex-encoded input per line" << std::endl;
+	std::cout << "\t-bo [file]\tBatch output, \"<input index> <hex solution>\" lines (default: stdout)" << std::endl;
+	std::cout << "\t-pw [watts]\tHold package+DRAM power at target by parking/pacing workers (RAPL)" << std::endl;
+	std::cout << "\t-pr [path]\tPowercap sysfs root (default: " POWERCAP_DEFAULT_PATH ")" << std::endl;
+	std::cout << "\t-jo [name]\tOwn the stratum connection and publish jobs to local processes (default: " JOBBUS_DEFAULT_NAME ")" << std::endl;
+	std::cout << "\t-ja [name]\tSolver-only: take jobs from a local owner process instead of stratum" << std::endl;
 	std::cout << std::endl;
 	std::cout << "CPU settings" << std::endl;
 	std::cout << "\t-t [num_thrds]\tNumber of CPU threads" << std::endl;
-	std::cout << "\t-e [ext]\tForce CPU ext (0 = SSE2, 1 = AVX, 2 = AVX2)" << std::endl;
+	std::cout << "\t-e [ext]\tForce CPU ext (0 = SSE2, 1 = AVX, 2 = AVX2, 3 = AVX-512)" << std::endl;
 	std::cout << std::endl;
 	std::cout << "Advanced Solver settings" << std::endl;
 	std::cout << "\t-c1927 [threads]\tEnable Equihash 192,7 solver with thread count" << std::endl;
+	std::cout << "\t-c1927p\t\tProbe memory bandwidth/latency and report per-stage roofline efficiency" << std::endl;
+	std::cout << "\t-c1927smt\tRun a prefetch helper on each solver thread's SMT sibling, report per-stage gain" << std::endl;
 	std::cout << std::endl;
 	std::cout << "NVIDIA CUDA settings" << std::endl;
 	std::cout << "\t-ci\t\tCUDA info" << std::endl;
@@ -154,6 +177,17 @@ int opencl_threads[MAX_INSTANCES] = { 0 };
 // todo: opencl local and global worksize
 
 
+static uint64_t read_xcr0()
+{
+#ifdef __linux__
+	uint32_t lo, hi;
+	asm("xgetbv" : "=a" (lo), "=d" (hi) : "c" (0));
+	return ((uint64_t)hi << 32) | lo;
+#else
+	return _xgetbv(0);
+#endif
+}
+
 void detect_AVX_and_AVX2()
 {
     // Fix on Linux
@@ -185,13 +219,39 @@ void detect_AVX_and_AVX2()
 	{
 		f_7_EBX_ = data_[7][1];
 		use_avx2 = f_7_EBX_[5];
+		// AVX-512 F, BW and VL, and the OS has to save the opmask and zmm state
+		if (f_7_EBX_[16] && f_7_EBX_[30] && f_7_EBX_[31] && f_1_ECX_[27])
+			use_avx512 = (read_xcr0() & 0xe6) == 0xe6;
 	}
 }
 
 
+// Called every 10 ms from the main loop
+static void report_status(int& c)
+{
+	// Changed interval as to when speed is displayed from approx 12 seconds
+	// to approx 150 seconds [2.5 minutes]
+	if (++c % 12500 == 0) {
+		double allshares = speed.GetShareSpeed() * 60;
+		double accepted = speed.GetShareOKSpeed() * 60;
+		BOOST_LOG_TRIVIAL(info) << CL_YLW "Speed [" << INTERVAL_SECONDS << " sec]: " <<
+			speed.GetHashSpeed() << " I/s, " <<
+			speed.GetSolutionSpeed() << " Sols/s" <<
+			//accepted << " AS/min, " << 
+			//(allshares - accepted) << " RS/min" 
+			CL_N;
+		if (energy.IsAvailable())
+			BOOST_LOG_TRIVIAL(info) << CL_YLW "Power: " << energy.GetPower() << " W, " <<
+				energy.GetSolsPerJoule() << " Sols/J, " <<
+				energy.GetActiveWorkers() << " active workers" CL_N;
+	}
+	energy.Regulate();
+}
+
+
 void start_mining(int api_port, const std::string& host, const std::string& port,
 	const std::string& user, const std::string& password,
-	ZcashStratumClient* handler, const std::vector<ISolver *> &i_solvers)
+	ZcashStratumClient* handler, const std::vector<ISolver *> &i_solvers, JobBus* bus)
 {
 	std::shared_ptr<boost::asio::io_service> io_service(new boost::asio::io_service);
 
@@ -215,38 +275,92 @@ void start_mining(int api_port, const std::string& host, const std::string& port
 		return sc.submit(&solution, jobid);
 	});
 
+	// Every job this process receives is also published to the attached processes
+	if (bus)
+		miner.NewJob.connect([bus](const ZcashJob* job) { bus->PublishJob(job); });
+
 	handler = &sc;
 	signal(SIGINT, stratum_sigint_handler);
 
 	int c = 0;
 	while (sc.isRunning()) {
 		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		if (bus) bus->DrainSolutions(miner);
+		report_status(c);
+		if (api) while (api->poll()) {}
+	}
 
-		// Changed interval as to when speed is displayed from approx 12 seconds
-		// to approx 150 seconds [2.5 minutes]
-		if (++c % 12500 == 0) {
-			double allshares = speed.GetShareSpeed() * 60;
-			double accepted = speed.GetShareOKSpeed() * 60;
-			BOOST_LOG_TRIVIAL(info) << CL_YLW "Speed [" << INTERVAL_SECONDS << " sec]: " <<
-				speed.GetHashSpeed() << " I/s, " <<
-				speed.GetSolutionSpeed() << " Sols/s" <<
-				//accepted << " AS/min, " << 
-				//(allshares - accepted) << " RS/min" 
-				CL_N;
+	if (api) delete api;
+}
+
+
+void start_attached(int api_port, JobBus& bus, const std::vector<ISolver *> &i_solvers)
+{
+	std::shared_ptr<boost::asio::io_service> io_service(new boost::asio::io_service);
+
+	API* api = nullptr;
+	if (api_port > 0)
+	{
+		api = new API(io_service);
+		if (!api->start(api_port))
+		{
+			delete api;
+			api = nullptr;
+		}
+	}
+
+	ZcashMiner miner(i_solvers);
+	miner.onSolutionFound([&](const EquihashSolution& solution, const std::string& jobid) {
+		return bus.PushSolution(solution, jobid);
+	});
+	miner.start();
+
+	signal(SIGINT, attached_sigint_handler);
+
+	// Same double buffering as the stratum client: the job before the current
+	// one stays alive while the miner threads may still read it
+	std::unique_ptr<ZcashJob> current, previous;
+	int c = 0;
+	while (attachedRunning.load()) {
+		ZcashJob* job;
+		if (bus.NextJob(job, 10))
+		{
+			if (job)
+				BOOST_LOG_TRIVIAL(info) << CL_CYN "Received job #" << job->jobId() << " from job bus" CL_N;
+			previous = std::move(current);
+			current.reset(job);
+			miner.setJob(job);
 		}
+		report_status(c);
 		if (api) while (api->poll()) {}
 	}
 
+	miner.stop();
 	if (api) delete api;
 }
 
 
+static bool is_batch_mode(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; ++i)
+		if (strcmp(argv[i], "-bi") == 0 || strcmp(argv[i], "-bx") == 0) return true;
+	return false;
+}
+
+
 int main(int argc, char* argv[])
 {
 #if defined(WIN32) && defined(NDEBUG)
 	system(""); // windows 10 colored console
 #endif
 
+	// Batch mode may write its solutions to stdout, keep that clean
+	if (is_batch_mode(argc, argv) && !BatchSolve_ReserveStdout())
+	{
+		std::cerr << "Cannot redirect stdout for batch mode" << std::endl;
+		return 1;
+	}
+
 	std::cout << std::endl;
 	std::cout << "\t==================== www.nicehash.com ====================" << std::endl;
 	std::cout << "\t\tEquihash CPU&GPU Miner for NiceHash v" STANDALONE_MINER_VERSION << std::endl;
@@ -263,6 +377,7 @@ int main(int argc, char* argv[])
 	bool benchmark = false;
 	int log_level = 2;
 	int num_hashes = 200;
+	int exit_code = 0;
 	int api_port = 0;
 	int cuda_device_count = 0;
 	int cuda_bc = 0;
@@ -271,6 +386,13 @@ int main(int argc, char* argv[])
 	int opencl_device_count = 0;
 	int force_cpu_ext = -1;
 	int opencl_t = 0;
+	std::string powercap_path = POWERCAP_DEFAULT_PATH;
+	double power_target = 0;
+	std::string jobbus_name;
+	std::string batch_input;
+	std::string batch_output;
+	bool batch_hex = false;
+	bool jobbus_owner = false;
 
 	for (int i = 1; i < argc; ++i)
 	{
@@ -286,6 +408,16 @@ int main(int argc, char* argv[])
 				solver1927_threads = atoi(argv[++i]);
 				break;
 			}
+			if (strcmp(argv[i], "-c1927p") == 0)
+			{
+				solver1927_probe = 1;
+				break;
+			}
+			if (strcmp(argv[i], "-c1927smt") == 0)
+			{
+				solver1927_smt = 1;
+				break;
+			}
 			
 			switch (argv[i][2])
 			{
@@ -390,6 +522,15 @@ int main(int argc, char* argv[])
 		//	}
 		//	break;
 		//}
+		case 'j':
+			if (strcmp(argv[i], "-jo") == 0 || strcmp(argv[i], "-ja") == 0)
+			{
+				jobbus_owner = argv[i][2] == 'o';
+				jobbus_name = JOBBUS_DEFAULT_NAME;
+				if (i + 1 < argc && argv[i + 1][0] != '-')
+					jobbus_name = argv[++i];
+			}
+			break;
 		case 'l':
 			location = argv[++i];
 			break;
@@ -397,6 +538,16 @@ int main(int argc, char* argv[])
 			user = argv[++i];
 			break;
 		case 'p':
+			if (strcmp(argv[i], "-pw") == 0 && i + 1 < argc)
+			{
+				power_target = atof(argv[++i]);
+				break;
+			}
+			if (strcmp(argv[i], "-pr") == 0 && i + 1 < argc)
+			{
+				powercap_path = argv[++i];
+				break;
+			}
 			password = argv[++i];
 			break;
 		case 't':
@@ -406,6 +557,17 @@ int main(int argc, char* argv[])
 			print_help();
 			return 0;
 		case 'b':
+			if ((strcmp(argv[i], "-bi") == 0 || strcmp(argv[i], "-bx") == 0) && i + 1 < argc)
+			{
+				batch_hex = argv[i][2] == 'x';
+				batch_input = argv[++i];
+				break;
+			}
+			if (strcmp(argv[i], "-bo") == 0 && i + 1 < argc)
+			{
+				batch_output = argv[++i];
+				break;
+			}
 			benchmark = true;
 			if (argv[i + 1] && argv[i + 1][0] != '-')
 				num_hashes = atoi(argv[++i]);
@@ -433,6 +595,11 @@ int main(int argc, char* argv[])
 			use_avx = 1;
 			use_avx2 = 1;
 			break;
+		case 3:
+			use_avx = 1;
+			use_avx2 = 1;
+			use_avx512 = 1;
+			break;
 		}
 	}
 	else
@@ -458,11 +625,43 @@ int main(int argc, char* argv[])
 	BOOST_LOG_TRIVIAL(info) << "Using SSE2: YES";
 	BOOST_LOG_TRIVIAL(info) << "Using AVX: " << (use_avx ? "YES" : "NO");
 	BOOST_LOG_TRIVIAL(info) << "Using AVX2: " << (use_avx2 ? "YES" : "NO");
+	BOOST_LOG_TRIVIAL(info) << "Using AVX-512: " << (use_avx512 ? "YES" : "NO");
+
+	if (energy.Init(powercap_path))
+		energy.SetPowerTarget(power_target);
+	else if (power_target > 0)
+		BOOST_LOG_TRIVIAL(warning) << "Power target ignored, no RAPL energy counters available";
+
+#ifdef USE_SOLVER1927
+	if (solver1927_probe)
+	{
+		BOOST_LOG_TRIVIAL(info) << "Probing memory hierarchy...";
+		if (Solver1927::g_memory_probe.run())
+			BOOST_LOG_TRIVIAL(info) << Solver1927::g_memory_probe.get_summary_string();
+	}
+	Solver1927::g_smt_helper_enabled = solver1927_smt != 0;
+#endif
 
 	try
 	{
 		_MinerFactory = new MinerFactory(use_avx == 1, use_old_cuda == 0, use_old_xmp == 0);
-		if (!benchmark)
+		JobBus bus;
+		if (!batch_input.empty())
+		{
+			if (!Solvers_doBatchSolve(batch_input, batch_hex, batch_output,
+				_MinerFactory->GenerateSolvers(num_threads, cuda_device_count, cuda_enabled, cuda_blocks,
+				cuda_tpb, opencl_device_count, opencl_platform, opencl_enabled, opencl_threads)))
+				exit_code = 1;
+		}
+		else if (!benchmark && !jobbus_name.empty() && !jobbus_owner)
+		{
+			if (!bus.Attach(jobbus_name))
+				BOOST_LOG_TRIVIAL(info) << "Waiting for a job bus owner on " << jobbus_name;
+			start_attached(api_port, bus,
+				_MinerFactory->GenerateSolvers(num_threads, cuda_device_count, cuda_enabled, cuda_blocks,
+				cuda_tpb, opencl_device_count, opencl_platform, opencl_enabled, opencl_threads));
+		}
+		else if (!benchmark)
 		{
 			if (user.length() == 0)
 			{
@@ -474,10 +673,15 @@ int main(int argc, char* argv[])
 			std::string host = delim != std::string::npos ? location.substr(0, delim) : location;
 			std::string port = delim != std::string::npos ? location.substr(delim + 1) : "2142";
 
+			// Another live owner keeps the bus; a second one would split the attached processes
+			if (jobbus_owner && !bus.Create(jobbus_name))
+				return 1;
+
 			start_mining(api_port, host, port, user, password,
 				scSig,
 				_MinerFactory->GenerateSolvers(num_threads, cuda_device_count, cuda_enabled, cuda_blocks,
-				cuda_tpb, opencl_device_count, opencl_platform, opencl_enabled, opencl_threads));
+				cuda_tpb, opencl_device_count, opencl_platform, opencl_enabled, opencl_threads),
+				jobbus_owner ? &bus : nullptr);
 		}
 		else
 		{
@@ -491,6 +695,6 @@ int main(int argc, char* argv[])
 
 	boost::log::core::get()->remove_all_sinks();
 
-	return 0;
+	return exit_code;
 }
 
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#ifdef WIN32
+#include <malloc.h>
+#endif
+
+// Work-stealing scheduler for a range of independent indices, such as the
+// buckets of one equihash digit round.
+// reset() splits [0, total) evenly into per-thread deques. Each owner takes
+// chunks from the front of its deque. A thread whose deque is empty steals
+// the back half of another thread's remainder, so a slow thread (SMT sibling,
+// lower turbo bin, fuller buckets) hands work to the fast ones instead of
+// holding up the round barrier.
+// reset() is not thread safe: call it from one thread between barriers.
+class WorkStealingScheduler
+{
+	struct alignas(64) Deque
+	{
+		std::atomic<bool> locked;
+		uint32_t begin;
+		uint32_t end;
+
+		void lock()
+		{
+			while (locked.exchange(true, std::memory_order_acquire))
+			{
+				while (locked.load(std::memory_order_relaxed)) {}
+			}
+		}
+		void unlock() { locked.store(false, std::memory_order_release); }
+
+		// Plain new[] does not honour the cache-line alignment before C++17
+		static void* operator new[](size_t sz)
+		{
+#ifdef WIN32
+			void* mem = _aligned_malloc(sz, alignof(Deque));
+#else
+			void* mem;
+			if (posix_memalign(&mem, alignof(Deque), sz))
+				mem = nullptr;
+#endif
+			if (!mem)
+				throw std::bad_alloc();
+			return mem;
+		}
+		static void operator delete[](void* mem)
+		{
+#ifdef WIN32
+			_aligned_free(mem);
+#else
+			free(mem);
+#endif
+		}
+	};
+
+	uint32_t m_threads;
+	uint32_t m_chunk;
+	std::unique_ptr<Deque[]> m_deques;
+
+	bool Pop(Deque& d, uint32_t& begin, uint32_t& end)
+	{
+		d.lock();
+		bool ok = d.begin < d.end;
+		if (ok)
+		{
+			begin = d.begin;
+			end = d.end - d.begin > m_chunk ? d.begin + m_chunk : d.end;
+			d.begin = end;
+		}
+		d.unlock();
+		return ok;
+	}
+
+	bool Steal(Deque& victim, uint32_t& begin, uint32_t& end)
+	{
+		victim.lock();
+		uint32_t left = victim.end - victim.begin;
+		bool ok = victim.begin < victim.end;
+		if (ok)
+		{
+			uint32_t take = left > m_chunk ? left / 2 : left;
+			end = victim.end;
+			begin = victim.end - take;
+			victim.end = begin;
+		}
+		victim.unlock();
+		return ok;
+	}
+
+public:
+	WorkStealingScheduler(uint32_t threads, uint32_t chunk = 16)
+		: m_threads(threads ? threads : 1), m_chunk(chunk ? chunk : 1), m_deques(new Deque[m_threads])
+	{
+		for (uint32_t i = 0; i < m_threads; ++i)
+		{
+			m_deques[i].locked.store(false);
+			m_deques[i].begin = m_deques[i].end = 0;
+		}
+	}
+
+	void reset(uint32_t total, uint32_t chunk = 0)
+	{
+		if (chunk) m_chunk = chunk;
+		for (uint32_t i = 0; i < m_threads; ++i)
+		{
+			m_deques[i].begin = (uint32_t)((uint64_t)total * i / m_threads);
+			m_deques[i].end = (uint32_t)((uint64_t)total * (i + 1) / m_threads);
+		}
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+
+	// Next range [begin, end) for thread id; false once the round is drained
+	bool next(uint32_t id, uint32_t& begin, uint32_t& end)
+	{
+		Deque& own = m_deques[id];
+		if (Pop(own, begin, end))
+			return true;
+
+		for (uint32_t i = 1; i < m_threads; ++i)
+		{
+			uint32_t sbegin, send;
+			if (!Steal(m_deques[(id + i) % m_threads], sbegin, send))
+				continue;
+			// Keep a chunk, publish the rest in our own deque for others to steal
+			own.lock();
+			own.begin = sbegin;
+			own.end = send;
+			own.unlock();
+			if (Pop(own, begin, end))
+				return true;
+		}
+		return false;
+	}
+};
@@ -0,0 +1,94 @@
+#include "arena.hpp"
+#include "memory_pool.hpp"
+#include <algorithm>
+
+namespace Solver1927 {
+
+Arena::Arena(size_t block_size) : block_size(block_size) {
+    // Room for spill bookkeeping so growing the block list is not itself a malloc
+    blocks.reserve(64);
+}
+
+Arena::~Arena() {
+    free_blocks();
+}
+
+bool Arena::add_block(size_t min_size) {
+    size_t size = std::max(min_size, block_size);
+    uint8_t* data = static_cast<uint8_t*>(AlignedAllocator::allocate(size, 64));
+    if (!data) return false;
+    blocks.push_back(Block{data, size});
+    upstream_allocations++;
+    return true;
+}
+
+void Arena::free_blocks() {
+    for (auto& block : blocks) {
+        AlignedAllocator::deallocate(block.data);
+    }
+    blocks.clear();
+}
+
+void* Arena::allocate(size_t bytes, size_t alignment) {
+    while (true) {
+        if (current < blocks.size()) {
+            Block& block = blocks[current];
+            uintptr_t base = reinterpret_cast<uintptr_t>(block.data);
+            uintptr_t aligned = (base + offset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+            size_t end = (aligned - base) + bytes;
+            if (end <= block.size) {
+                offset = end;
+                high_water = std::max(high_water, get_used());
+                last_allocation = reinterpret_cast<uint8_t*>(aligned);
+                return last_allocation;
+            }
+            // The remainder of this block is lost until reset()
+            spilled_bytes += block.size;
+            current++;
+            offset = 0;
+            continue;
+        }
+        if (!add_block(bytes + alignment)) {
+            throw std::bad_alloc();
+        }
+    }
+}
+
+void Arena::deallocate(void* ptr, size_t /*bytes*/) {
+    if (ptr && ptr == last_allocation) {
+        offset = static_cast<size_t>(last_allocation - blocks[current].data);
+        last_allocation = nullptr;
+    }
+}
+
+uint64_t Arena::reset(size_t expected_bytes) {
+    uint64_t made = upstream_allocations - upstream_at_reset;
+
+    // Merge spill blocks so the next solve of the same size fits in one. The
+    // high-water mark also counts storage stranded by grown vectors, so the
+    // caller's estimate is preferred when it has one.
+    size_t merged = expected_bytes > 0 ? expected_bytes : high_water + high_water / 8;
+    bool oversized = blocks.size() == 1 && blocks[0].size > std::max(block_size, 2 * merged);
+    if (blocks.size() > 1 || oversized) {
+        free_blocks();
+        add_block(merged);
+    }
+
+    current = 0;
+    offset = 0;
+    spilled_bytes = 0;
+    last_allocation = nullptr;
+    upstream_at_reset = upstream_allocations;
+    resets++;
+    return made;
+}
+
+size_t Arena::get_capacity() const {
+    size_t total = 0;
+    for (const auto& block : blocks) {
+        total += block.size;
+    }
+    return total;
+}
+
+} // namespace Solver1927
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <new>
+#include <type_traits>
+
+namespace Solver1927 {
+
+/**
+ * Bump allocator for per-solve transient data
+ * Allocation is a pointer bump and nothing is freed individually. reset() at
+ * the start of a solve rewinds to empty; if the previous solve spilled into
+ * extra blocks they are merged into one block sized for what the caller
+ * expects the next solve to use, so a steady-state solve makes no upstream
+ * (malloc) calls.
+ */
+class Arena {
+public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 64 * 1024 * 1024;
+
+    explicit Arena(size_t block_size = DEFAULT_BLOCK_SIZE);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+    // Only the most recent allocation can be given back; anything else waits for reset()
+    void deallocate(void* ptr, size_t bytes);
+
+    // Rewind to empty. Returns the upstream allocations made since the last reset.
+    // expected_bytes sizes the retained block (0: the high-water mark); a block
+    // more than twice that is replaced so one oversized solve is not kept forever.
+    uint64_t reset(size_t expected_bytes = 0);
+
+    size_t get_used() const { return spilled_bytes + offset; }
+    size_t get_capacity() const;
+    size_t get_high_water() const { return high_water; }
+    uint64_t get_upstream_allocations() const { return upstream_allocations; }
+    uint64_t get_resets() const { return resets; }
+
+private:
+    struct Block {
+        uint8_t* data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks;
+    size_t current = 0;         // Block being bumped
+    size_t offset = 0;          // Bump offset in the current block
+    size_t spilled_bytes = 0;   // Bytes used in blocks before the current one
+    size_t high_water = 0;
+    size_t block_size;
+    uint8_t* last_allocation = nullptr;
+
+    uint64_t upstream_allocations = 0;
+    uint64_t upstream_at_reset = 0;
+    uint64_t resets = 0;
+
+    bool add_block(size_t min_size);
+    void free_blocks();
+};
+
+/**
+ * STL adaptor so containers can draw from an Arena
+ * deallocate() is a no-op unless it returns the latest allocation.
+ */
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+    // Storage moves with the allocator, so containers can be rebound to another arena
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    // A default-constructed adaptor has no arena and must not allocate
+    ArenaAllocator() noexcept : arena(nullptr) {}
+    explicit ArenaAllocator(Arena* arena) noexcept : arena(arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena(other.get_arena()) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T* ptr, size_t n) noexcept {
+        if (arena) arena->deallocate(ptr, n * sizeof(T));
+    }
+
+    Arena* get_arena() const noexcept { return arena; }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const noexcept { return arena == other.get_arena(); }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const noexcept { return arena != other.get_arena(); }
+
+private:
+    Arena* arena;
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+} // namespace Solver1927
@@ -2,13 +2,30 @@
 #include <algorithm>
 #include <iostream>
 #include <iomanip>
-#include <sstream>
 #include <immintrin.h>
 #include <numeric>
+#include <chrono>
 #include <unordered_set>
 
 namespace Solver1927 {
 
+namespace {
+
+// The reports share std::cout with the rest of the solver; put its format back
+struct StreamFormatGuard {
+    std::ostream& os;
+    std::ios::fmtflags flags;
+    std::streamsize precision;
+    
+    explicit StreamFormatGuard(std::ostream& os) : os(os), flags(os.flags()), precision(os.precision()) {}
+    ~StreamFormatGuard() {
+        os.flags(flags);
+        os.precision(precision);
+    }
+};
+
+} // anonymous namespace
+
 CollisionDetector::CollisionDetector() {
     initialize_buckets();
     initialize_simd_functions();
@@ -22,10 +39,14 @@ void CollisionDetector::initialize_buckets() {
         bucket.reserve(8);  // Average expected bucket size
     }
     
-    // Initialize stage storage
-    for (auto& stage : stages) {
-        stage.reserve(100000);  // Reserve space for collision pairs
-    }
+    solution_scratch.reserve(1u << K);
+}
+
+size_t CollisionDetector::stage_reservation(const StageData& stage) {
+    size_t expected = stage.last_collision_count > 0
+                    ? stage.last_collision_count + stage.last_collision_count / 8
+                    : 100000;
+    return std::min(expected, MAX_TOTAL_COLLISIONS_PER_STAGE);
 }
 
 void CollisionDetector::initialize_simd_functions() {
@@ -61,6 +82,50 @@ bool CollisionDetector::detect_collisions(MemoryPool* pool, size_t hash_count,
     
     reset_stats();
     
+    // Rewind the per-solve arena; the stages must let go of it first. Size it
+    // for the stage reservations rather than the warm-up solve's high water,
+    // which includes the copies stranded while the collision vectors grew.
+    size_t expected_bytes = 0;
+    for (auto& stage : stages) {
+        stage.release();
+        expected_bytes += stage_reservation(stage) * sizeof(CollisionPair) + alignof(CollisionPair);
+    }
+    uint64_t upstream_allocations = solve_arena.reset(expected_bytes);
+#ifdef SOLVER1927_COUNT_ALLOCS
+    // Steady state: after the warm-up solve everything must fit the retained block
+    if (upstream_allocations > 0 && solve_arena.get_resets() > 2) {
+        std::cerr << "CollisionDetector: WARNING - previous solve made " << upstream_allocations
+                  << " arena block allocations (high water " << (solve_arena.get_high_water() >> 20)
+                  << " MB)" << std::endl;
+    }
+#endif
+    
+    if (g_smt_helper_enabled && !smt_helper && !smt_helper_unavailable) {
+        smt_helper.reset(new SmtHelper());
+        std::cout << "CollisionDetector: SMT prefetch helper " << smt_helper->get_placement_string() << std::endl;
+        if (!smt_helper->is_pinned()) {
+            // Without its own sibling the helper only steals cycles from the solver
+            std::cout << "CollisionDetector: SMT prefetch helper disabled for this solver" << std::endl;
+            smt_helper.reset();
+            smt_helper_unavailable = true;
+        } else {
+            bucket_storage.assign(BUCKET_COUNT, nullptr);
+            refresh_bucket_storage();
+        }
+    }
+    if (smt_helper) {
+        // Solve 0 warms up with the helper, then a bounded A/B phase, then always on
+        uint64_t solve = smt_solves++;
+        smt_measuring = solve >= 1 && solve <= SMT_AB_SOLVES;
+        smt_helper_on = !(smt_measuring && solve % 2 == 1);
+        if (solve == SMT_AB_SOLVES + 1) {
+            std::cout << "CollisionDetector: SMT helper A/B measurement done, keeping the helper on" << std::endl;
+        }
+    } else {
+        smt_measuring = false;
+        smt_helper_on = false;
+    }
+    
     std::cout << "CollisionDetector: Starting Equihash " << N << "," << K 
               << " collision detection" << std::endl;
     std::cout << "  Initial hashes: " << hash_count << std::endl;
@@ -81,6 +146,14 @@ bool CollisionDetector::detect_collisions(MemoryPool* pool, size_t hash_count,
                                                        stages[stage], stage, is_blake2b_input, prev_stage_data);
         
         std::cout << collisions_found << " collisions found" << std::endl;
+        std::cout << "    ";
+        print_stage_traffic(std::cout, stage);
+        std::cout << std::endl;
+        if (smt_measuring) {
+            std::cout << "    ";
+            print_smt_gain(std::cout, stage);
+            std::cout << std::endl;
+        }
         
         if (collisions_found == 0) {
             std::cout << "CollisionDetector: No collisions found at stage " << stage 
@@ -131,7 +204,11 @@ bool CollisionDetector::detect_collisions(MemoryPool* pool, size_t hash_count,
 size_t CollisionDetector::find_stage_collisions(const uint8_t* input_data, size_t input_count,
                                                StageData& output_stage, int stage_num, bool is_blake2b_input,
                                                const StageData* prev_stage) {
-    output_stage.clear();
+    // Reserve for what this stage produced last solve so the vector never grows
+    // inside the arena (a grown vector strands its old storage until reset)
+    output_stage.bind(solve_arena, stage_reservation(output_stage));
+    
+    auto scatter_start = std::chrono::steady_clock::now();
     
     // Clear all buckets for this stage
     for (auto& bucket : buckets) {
@@ -141,13 +218,22 @@ size_t CollisionDetector::find_stage_collisions(const uint8_t* input_data, size_
     // Populate buckets based on collision bits for this stage
     populate_buckets(input_data, input_count, stage_num, is_blake2b_input);
     
+    auto pairing_start = std::chrono::steady_clock::now();
+    
     // Process each bucket to find collisions
     size_t total_collisions = 0;
     size_t non_empty_buckets = 0;
     size_t max_bucket_size = 0;
     size_t total_hashes_in_buckets = 0;
     
+    if (smt_helper_on) {
+        smt_helper->begin(prefetch_pairing, &buckets, buckets.size(), 4, 128);
+    }
+    
     for (size_t bucket_id = 0; bucket_id < buckets.size(); bucket_id++) {
+        if (smt_helper_on && (bucket_id & 15) == 0) {
+            smt_helper->advance(bucket_id);
+        }
         const auto& bucket = buckets[bucket_id];
         if (bucket.empty()) continue;
         
@@ -161,6 +247,18 @@ size_t CollisionDetector::find_stage_collisions(const uint8_t* input_data, size_
         total_collisions += bucket_collisions;
     }
     
+    if (smt_helper_on) {
+        smt_helper->end();
+    }
+    
+    auto pairing_end = std::chrono::steady_clock::now();
+    
+    // Buckets that grew this stage moved their storage; the next stage's
+    // scatter prefetches from the snapshot
+    if (smt_helper) {
+        refresh_bucket_storage();
+    }
+    
     std::cout << "    Bucket statistics: " << non_empty_buckets << " non-empty, "
               << "max size: " << max_bucket_size << ", "  
               << "collision candidates: " << (non_empty_buckets - (total_hashes_in_buckets - non_empty_buckets)) 
@@ -174,6 +272,21 @@ size_t CollisionDetector::find_stage_collisions(const uint8_t* input_data, size_
         stats.avg_bucket_size = (double)total_hashes_in_buckets / non_empty_buckets;
     }
     
+    // Traffic model: inputs are read once to scatter and once again while pairing,
+    // bucket entries are written then read back, collision pairs are written out
+    auto& traffic = stats.stage[stage_num];
+    traffic.scatter_seconds = std::chrono::duration<double>(pairing_start - scatter_start).count();
+    traffic.pairing_seconds = std::chrono::duration<double>(pairing_end - pairing_start).count();
+    traffic.scatter_bytes = (uint64_t)input_count * sizeof(BucketEntry);
+    traffic.total_bytes = (uint64_t)input_count * 32 * 2
+                        + traffic.scatter_bytes * 2
+                        + (uint64_t)total_collisions * sizeof(CollisionPair);
+    
+    if (smt_measuring) {
+        smt_comparison.seconds[smt_helper_on][stage_num] += traffic.scatter_seconds + traffic.pairing_seconds;
+        smt_comparison.inputs[smt_helper_on][stage_num] += input_count;
+    }
+    
     return total_collisions;
 }
 
@@ -181,7 +294,15 @@ void CollisionDetector::populate_buckets(const uint8_t* hashes, size_t hash_coun
     std::cout << "CollisionDetector: Populating buckets for stage " << stage 
               << " with " << hash_count << (is_blake2b_input ? " Blake2b hashes" : " XOR results") << std::endl;
     
+    ScatterPrefetch prefetch{hashes, stage, buckets.data(), bucket_storage.data()};
+    if (smt_helper_on) {
+        smt_helper->begin(prefetch_scatter, &prefetch, hash_count, 16, 256);
+    }
+    
     for (size_t i = 0; i < hash_count; i++) {
+        if (smt_helper_on && (i & 15) == 0) {
+            smt_helper->advance(i);
+        }
         const uint8_t* hash = hashes + (i * 32);  // Each input is 32 bytes
         uint32_t bucket_id = extract_collision_bits(hash, stage);
         
@@ -204,6 +325,10 @@ void CollisionDetector::populate_buckets(const uint8_t* hashes, size_t hash_coun
         buckets[bucket_id].emplace_back(BucketEntry{static_cast<uint32_t>(i), hash});
     }
     
+    if (smt_helper_on) {
+        smt_helper->end();
+    }
+    
     // Debug: count non-empty buckets
     size_t non_empty = 0;
     for (const auto& bucket : buckets) {
@@ -327,6 +452,14 @@ uint32_t CollisionDetector::extract_collision_bits(const uint8_t* hash, int stag
         last_debug_stage = stage;
     }
     
+    return collision_bits(hash, stage);
+}
+
+uint32_t CollisionDetector::collision_bits(const uint8_t* hash, int stage) {
+    int start_bit = stage * COLLISION_BITS;
+    int start_byte = start_bit / 8;
+    int bit_offset = start_bit % 8;
+    
     // Extract 4 bytes and shift to get our 24 bits
     uint32_t value = 0;
     if (start_byte + 3 < 32) {  // Ensure we don't read beyond hash
@@ -342,6 +475,45 @@ uint32_t CollisionDetector::extract_collision_bits(const uint8_t* hash, int stag
     return value;
 }
 
+// Writes only the entries whose storage moved, which once the buckets have
+// grown to their working sizes is almost none
+void CollisionDetector::refresh_bucket_storage() {
+    for (size_t bucket_id = 0; bucket_id < buckets.size(); bucket_id++) {
+        const BucketEntry* storage = buckets[bucket_id].data();
+        if (bucket_storage[bucket_id] != storage) {
+            bucket_storage[bucket_id] = storage;
+        }
+    }
+}
+
+// Helper thread: touch the bucket header the solver is about to push into.
+// The entry storage behind it is being written by the solver, so it is not read.
+void CollisionDetector::prefetch_scatter(const void* context, size_t item) {
+    const auto* job = static_cast<const ScatterPrefetch*>(context);
+    uint32_t bucket_id = collision_bits(job->hashes + item * 32, job->stage);
+    if (bucket_id >= BUCKET_COUNT) return;
+    
+    // The scatter stores to the bucket's header (end pointer) and to its entry
+    // storage. Buckets average about two entries, so the first storage line
+    // takes nearly all of them; a bucket that regrew since the snapshot costs
+    // only a useless prefetch.
+    _mm_prefetch(reinterpret_cast<const char*>(job->headers + bucket_id), _MM_HINT_ET0);
+    const BucketEntry* storage = job->storage[bucket_id];
+    if (storage) {
+        _mm_prefetch(reinterpret_cast<const char*>(storage), _MM_HINT_ET0);
+    }
+}
+
+// Helper thread: buckets are read-only while pairing, so walk the entries of an
+// upcoming bucket and pull in the parent hashes the pair comparison will XOR
+void CollisionDetector::prefetch_pairing(const void* context, size_t item) {
+    const auto& bucket = (*static_cast<const std::vector<std::vector<BucketEntry>>*>(context))[item];
+    if (bucket.size() < 2) return;
+    for (const auto& entry : bucket) {
+        _mm_prefetch(reinterpret_cast<const char*>(entry.hash_ptr), _MM_HINT_T0);
+    }
+}
+
 bool CollisionDetector::verify_collision_bits(const uint8_t* hash_a, const uint8_t* hash_b, int stage) {
     // Extract the collision bits for both hashes and verify they match
     uint32_t bits_a = extract_collision_bits(hash_a, stage);  
@@ -391,15 +563,55 @@ void CollisionDetector::xor_avx512(const uint8_t* a, const uint8_t* b, uint8_t*
     _mm256_storeu_si256((__m256i*)result, vr);
 }
 
-std::string CollisionDetector::get_stats_string() const {
-    std::ostringstream oss;
-    oss << "Collision Stats: " 
-        << stats.total_comparisons << " comparisons, "
-        << stats.collisions_found << " collisions, "
-        << stats.buckets_used << " buckets used, "
-        << "avg bucket size: " << std::fixed << std::setprecision(1) << stats.avg_bucket_size
-        << ", max: " << stats.max_bucket_size;
-    return oss.str();
+void CollisionDetector::print_stats(std::ostream& os) const {
+    StreamFormatGuard guard(os);
+    os << "Collision Stats: " 
+       << stats.total_comparisons << " comparisons, "
+       << stats.collisions_found << " collisions, "
+       << stats.buckets_used << " buckets used, "
+       << "avg bucket size: " << std::fixed << std::setprecision(1) << stats.avg_bucket_size
+       << ", max: " << stats.max_bucket_size;
+}
+
+void CollisionDetector::print_stage_traffic(std::ostream& os, int stage) const {
+    const auto& traffic = stats.stage[stage];
+    double total_seconds = traffic.scatter_seconds + traffic.pairing_seconds;
+    double stage_gbps = total_seconds > 0.0 ? traffic.total_bytes / total_seconds / 1e9 : 0.0;
+    double scatter_gbps = traffic.scatter_seconds > 0.0 ? traffic.scatter_bytes / traffic.scatter_seconds / 1e9 : 0.0;
+    
+    StreamFormatGuard guard(os);
+    os << "Stage " << stage << " traffic: " << std::fixed << std::setprecision(2)
+       << stage_gbps << " GB/s in " << (total_seconds * 1000.0) << " ms, "
+       << "scatter " << scatter_gbps << " GB/s";
+    
+    if (g_memory_probe.has_results()) {
+        const auto& limits = g_memory_probe.get_results();
+        double stage_fraction = limits.seq_read_gbps > 0.0 ? stage_gbps / limits.seq_read_gbps : 0.0;
+        double scatter_fraction = limits.scatter_gbps > 0.0 ? scatter_gbps / limits.scatter_gbps : 0.0;
+        
+        // Either path running at half its roofline or better means memory sets the pace
+        bool memory_bound = stage_fraction >= 0.5 || scatter_fraction >= 0.5;
+        os << std::setprecision(0)
+           << " (" << (stage_fraction * 100.0) << "% of sequential, "
+           << (scatter_fraction * 100.0) << "% of scatter roofline) -> "
+           << (memory_bound ? "memory-bound" : "compute-bound");
+    }
+}
+
+void CollisionDetector::print_smt_gain(std::ostream& os, int stage) const {
+    const auto& ab = smt_comparison;
+    os << "Stage " << stage << " SMT helper: ";
+    if (ab.inputs[0][stage] == 0 || ab.inputs[1][stage] == 0) {
+        os << "gain pending (needs solves with and without the helper)";
+        return;
+    }
+    
+    double off_ns = ab.seconds[0][stage] * 1e9 / ab.inputs[0][stage];
+    double on_ns = ab.seconds[1][stage] * 1e9 / ab.inputs[1][stage];
+    StreamFormatGuard guard(os);
+    os << std::fixed << std::setprecision(2)
+       << on_ns << " ns/input with, " << off_ns << " ns/input without -> "
+       << std::showpos << std::setprecision(1) << ((off_ns / on_ns - 1.0) * 100.0) << "% gain";
 }
 
 bool CollisionDetector::validate_solution(const std::vector<uint32_t>& solution_indices) {
@@ -417,7 +629,7 @@ bool CollisionDetector::validate_solution(const std::vector<uint32_t>& solution_
 
 // Phase 3: Extract and validate complete Equihash solution
 void CollisionDetector::extract_solution(const CollisionPair& final_collision, 
-                                        std::function<void(const std::vector<uint32_t>&, size_t, const unsigned char*)> callback) {
+                                        const std::function<void(const std::vector<uint32_t>&, size_t, const unsigned char*)>& callback) {
     if (!final_collision.is_complete_solution()) {
         std::cout << "⚠️  Warning: Not a complete solution (Stage " << final_collision.stage_level 
                   << ", " << final_collision.get_solution_size() << " indices)" << std::endl;
@@ -428,7 +640,8 @@ void CollisionDetector::extract_solution(const CollisionPair& final_collision,
               << " indices..." << std::endl;
     
     // Reconstruct solution indices by tracing back through collision genealogy
-    std::vector<uint32_t> solution_indices;
+    std::vector<uint32_t>& solution_indices = solution_scratch;
+    solution_indices.clear();
     reconstruct_solution_indices(final_collision, solution_indices);
     
     // Ensure we have the expected number of indices (2^K = 128 for K=7)
@@ -6,8 +6,13 @@
 #include <cstring>
 #include <algorithm>
 #include <functional>
+#include <memory>
+#include <iosfwd>
 #include "memory_pool.hpp"
 #include "simd_detector.hpp"
+#include "memory_probe.hpp"
+#include "arena.hpp"
+#include "smt_helper.hpp"
 
 namespace Solver1927 {
 
@@ -90,17 +95,25 @@ struct CollisionPair {
 };
 
 // Stage data structure for pipeline processing
+// Collision storage comes from the detector's per-solve arena: bind() at the
+// start of a stage, release() before the arena is rewound.
 struct StageData {
-    std::vector<CollisionPair> collisions;
+    ArenaVector<CollisionPair> collisions;
     size_t collision_count = 0;
+    size_t last_collision_count = 0;  // Previous solve's count, sizes the next reservation
     
-    void clear() {
-        collisions.clear();
+    void bind(Arena& arena, size_t capacity) {
+        collisions = ArenaVector<CollisionPair>(ArenaAllocator<CollisionPair>(&arena));
+        collisions.reserve(capacity);
         collision_count = 0;
     }
     
-    void reserve(size_t capacity) {
-        collisions.reserve(capacity);
+    void release() {
+        if (!collisions.empty()) {
+            last_collision_count = collisions.size();
+        }
+        collisions = ArenaVector<CollisionPair>();
+        collision_count = 0;
     }
 };
 
@@ -138,7 +151,7 @@ public:
     void compute_xor_simd(const uint8_t* hash_a, const uint8_t* hash_b, uint8_t* result);
     
     // Phase 3: Solution extraction and validation
-    void extract_solution(const CollisionPair& final_collision, std::function<void(const std::vector<uint32_t>&, size_t, const unsigned char*)> callback);
+    void extract_solution(const CollisionPair& final_collision, const std::function<void(const std::vector<uint32_t>&, size_t, const unsigned char*)>& callback);
     
     // Reconstruct solution indices by tracing collision genealogy
     void reconstruct_solution_indices(const CollisionPair& collision, std::vector<uint32_t>& result);
@@ -153,15 +166,42 @@ public:
         uint64_t buckets_used = 0;
         double avg_bucket_size = 0.0;
         uint32_t max_bucket_size = 0;
+        
+        // Per-stage memory traffic (estimated from entry sizes) for roofline reporting
+        struct StageTraffic {
+            double scatter_seconds = 0.0;   // Bucket clear + population
+            double pairing_seconds = 0.0;   // Bucket pair comparison + XOR output
+            uint64_t scatter_bytes = 0;     // Random 16-byte bucket entry stores
+            uint64_t total_bytes = 0;       // All bytes read and written by the stage
+        } stage[STAGES];
     } stats;
     
     void reset_stats() { stats = CollisionStats{}; }
-    std::string get_stats_string() const;
+    
+    // Reports are written straight to the stream so the solve path builds no strings
+    void print_stats(std::ostream& os) const;
+    
+    // Achieved bandwidth of a stage, as a fraction of g_memory_probe limits when available
+    void print_stage_traffic(std::ostream& os, int stage) const;
+    
+    // Stops the SMT helper and unpins the solver thread; call from that thread.
+    // The next solve starts a new helper.
+    void release_smt_helper() { smt_helper.reset(); }
+    
+    // SMT helper A/B result for a stage: time per input with and without the
+    // helper over the measurement solves
+    void print_smt_gain(std::ostream& os, int stage) const;
     
 private:
     // Stage data pipeline
     std::array<StageData, STAGES> stages;
     
+    // Per-solve transient storage, rewound at the start of detect_collisions
+    Arena solve_arena;
+    
+    // Reused for every extracted solution (the callback takes a std::vector)
+    std::vector<uint32_t> solution_scratch;
+    
     // Bucket management for hash sorting
     struct BucketEntry {
         uint32_t hash_index;
@@ -170,12 +210,48 @@ private:
     
     std::vector<std::vector<BucketEntry>> buckets;
     
+    // Entry storage of each bucket, so the SMT helper can prefetch scatter
+    // destinations without reading the vectors the solver is growing. clear()
+    // keeps a bucket's storage, so the snapshot is refreshed after each stage,
+    // outside the timed scatter, and only where a bucket's storage moved.
+    std::vector<const BucketEntry*> bucket_storage;
+    void refresh_bucket_storage();
+    
+    // SMT prefetch helper (-c1927smt). After a warm-up solve, the next
+    // SMT_AB_SOLVES alternate with and without it to measure its gain on this
+    // host; from then on it stays on.
+    static constexpr uint64_t SMT_AB_SOLVES = 6;
+    std::unique_ptr<SmtHelper> smt_helper;
+    bool smt_helper_on = false;
+    bool smt_measuring = false;
+    bool smt_helper_unavailable = false;
+    uint64_t smt_solves = 0;
+    struct {
+        double seconds[2][STAGES] = {};   // [helper off/on][stage]
+        uint64_t inputs[2][STAGES] = {};
+    } smt_comparison;
+    
+    struct ScatterPrefetch {
+        const uint8_t* hashes;
+        int stage;
+        const std::vector<BucketEntry>* headers;
+        const BucketEntry* const* storage;
+    };
+    static void prefetch_scatter(const void* context, size_t item);
+    static void prefetch_pairing(const void* context, size_t item);
+    
     // Internal collision detection methods
     void initialize_buckets();
+    
+    // Collision capacity reserved for a stage: last solve's count plus headroom
+    static size_t stage_reservation(const StageData& stage);
     void populate_buckets(const uint8_t* hashes, size_t hash_count, int stage, bool is_blake2b_input = true);
     size_t process_bucket_collisions(size_t bucket_id, StageData& output, int stage, const StageData* prev_stage = nullptr);
     bool verify_collision_bits(const uint8_t* hash_a, const uint8_t* hash_b, int stage);
     
+    // Side-effect free bit extraction, safe to call from the helper thread
+    static uint32_t collision_bits(const uint8_t* hash, int stage);
+    
     // SIMD dispatch functions
     void (*xor_function)(const uint8_t*, const uint8_t*, uint8_t*) = nullptr;
     
@@ -0,0 +1,69 @@
+#include "heap_counter.hpp"
+#include <cstdlib>
+#include <new>
+
+namespace Solver1927 {
+
+#ifdef SOLVER1927_COUNT_ALLOCS
+
+namespace {
+// Plain POD so touching it from operator new needs no TLS initialisation
+thread_local uint64_t t_heap_allocations = 0;
+} // anonymous namespace
+
+uint64_t get_thread_heap_allocations() {
+    return t_heap_allocations;
+}
+
+// Backs the operator new replacements below
+void* counted_allocate(std::size_t size) {
+    t_heap_allocations++;
+    if (size == 0) size = 1;
+    while (true) {
+        void* ptr = std::malloc(size);
+        if (ptr) return ptr;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+#else
+
+uint64_t get_thread_heap_allocations() {
+    return 0;
+}
+
+#endif
+
+} // namespace Solver1927
+
+#ifdef SOLVER1927_COUNT_ALLOCS
+
+// Replaces the global forms for the whole program; the object is always linked
+// because the solver calls get_thread_heap_allocations()
+void* operator new(std::size_t size) {
+    return Solver1927::counted_allocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return Solver1927::counted_allocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+#endif
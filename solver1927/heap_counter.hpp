@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Solver1927 {
+
+/**
+ * Debug-build heap allocation counter
+ * With SOLVER1927_COUNT_ALLOCS (set for CMake Debug builds) the global
+ * operator new is replaced by a malloc-backed one that counts allocations per
+ * thread, so a solve can check that it made none once warmed up. Other builds
+ * keep the library's operator new and always report 0.
+ */
+uint64_t get_thread_heap_allocations();
+
+} // namespace Solver1927
@@ -0,0 +1,169 @@
+#include "memory_probe.hpp"
+#include "memory_pool.hpp"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace Solver1927 {
+
+// Global instance
+MemoryProbe g_memory_probe;
+
+namespace {
+
+using probe_clock = std::chrono::steady_clock;
+
+double seconds_since(probe_clock::time_point start) {
+    return std::chrono::duration<double>(probe_clock::now() - start).count();
+}
+
+// Cache sizes from the C library where available, sane defaults otherwise
+size_t query_cache_size(int level, size_t fallback) {
+#if !defined(_WIN32) && defined(_SC_LEVEL2_CACHE_SIZE) && defined(_SC_LEVEL3_CACHE_SIZE)
+    long value = sysconf(level == 2 ? _SC_LEVEL2_CACHE_SIZE : _SC_LEVEL3_CACHE_SIZE);
+    if (value > 0) return static_cast<size_t>(value);
+#endif
+    return fallback;
+}
+
+inline uint64_t xorshift64(uint64_t& state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// Keeps the measured loops from being optimized away
+volatile uint64_t g_probe_sink = 0;
+
+} // anonymous namespace
+
+double MemoryProbe::measure_read(const uint64_t* buffer, size_t words, int passes) {
+    auto start = probe_clock::now();
+    uint64_t acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+    for (int pass = 0; pass < passes; pass++) {
+        for (size_t i = 0; i + 4 <= words; i += 4) {
+            acc0 += buffer[i];
+            acc1 += buffer[i + 1];
+            acc2 += buffer[i + 2];
+            acc3 += buffer[i + 3];
+        }
+    }
+    double elapsed = seconds_since(start);
+    g_probe_sink = acc0 + acc1 + acc2 + acc3;
+    return (double)words * sizeof(uint64_t) * passes / elapsed / 1e9;
+}
+
+double MemoryProbe::measure_write(uint64_t* buffer, size_t words, int passes) {
+    auto start = probe_clock::now();
+    for (int pass = 0; pass < passes; pass++) {
+        for (size_t i = 0; i < words; i++) {
+            buffer[i] = i + pass;
+        }
+    }
+    double elapsed = seconds_since(start);
+    g_probe_sink = buffer[words / 2];
+    return (double)words * sizeof(uint64_t) * passes / elapsed / 1e9;
+}
+
+double MemoryProbe::measure_latency(uint64_t* buffer, size_t bytes, size_t hops) {
+    // One node per 64-byte line, linked into a single random cycle (Sattolo)
+    // so every load depends on the previous one and defeats the prefetchers
+    const size_t stride = 64 / sizeof(uint64_t);
+    const size_t lines = std::max<size_t>(bytes / 64, 2);
+    uint64_t rng = 0x9E3779B97F4A7C15ull;
+
+    for (size_t i = 0; i < lines; i++) {
+        buffer[i * stride] = i;
+    }
+    for (size_t i = lines - 1; i > 0; i--) {
+        size_t j = xorshift64(rng) % i;
+        std::swap(buffer[i * stride], buffer[j * stride]);
+    }
+
+    // Warm the working set once before timing
+    uint64_t node = 0;
+    for (size_t i = 0; i < lines; i++) {
+        node = buffer[node * stride];
+    }
+
+    auto start = probe_clock::now();
+    for (size_t i = 0; i < hops; i++) {
+        node = buffer[node * stride];
+    }
+    double elapsed = seconds_since(start);
+    g_probe_sink = node;
+    return elapsed * 1e9 / hops;
+}
+
+double MemoryProbe::measure_scatter(uint64_t* buffer, size_t bytes, size_t stores) {
+    // 16-byte entries written to random slots, mirroring BucketEntry pushes
+    const size_t entries = bytes / 16;
+    uint64_t rng = 0xD1B54A32D192ED03ull;
+
+    auto start = probe_clock::now();
+    for (size_t i = 0; i < stores; i++) {
+        size_t slot = xorshift64(rng) % entries;
+        buffer[slot * 2] = i;
+        buffer[slot * 2 + 1] = slot;
+    }
+    double elapsed = seconds_since(start);
+    g_probe_sink = buffer[0];
+    return (double)stores * 16 / elapsed / 1e9;
+}
+
+bool MemoryProbe::run(size_t dram_bytes) {
+    std::lock_guard<std::mutex> lock(run_mutex);
+
+    Results r;
+    r.l2_bytes = query_cache_size(2, 1024 * 1024);
+    r.l3_bytes = query_cache_size(3, 32 * 1024 * 1024);
+    r.dram_bytes = dram_bytes ? dram_bytes
+                              : std::min<size_t>(std::max<size_t>(r.l3_bytes * 4, 256ull << 20), 512ull << 20);
+
+    uint64_t* buffer = static_cast<uint64_t*>(AlignedAllocator::allocate(r.dram_bytes, 64));
+    if (!buffer) {
+        std::cerr << "MemoryProbe: ERROR - Failed to allocate " << r.dram_bytes << " byte probe buffer" << std::endl;
+        return false;
+    }
+
+    const size_t words = r.dram_bytes / sizeof(uint64_t);
+
+    // Write first: it also faults in every page before the read pass
+    measure_write(buffer, words, 1);
+    r.seq_write_gbps = measure_write(buffer, words, 2);
+    r.seq_read_gbps = measure_read(buffer, words, 2);
+    r.scatter_gbps = measure_scatter(buffer, r.dram_bytes, 8 * 1024 * 1024);
+
+    const size_t hops = 1024 * 1024;
+    r.latency_l2_ns = measure_latency(buffer, r.l2_bytes / 2, hops);
+    r.latency_l3_ns = measure_latency(buffer, r.l3_bytes / 2, hops);
+    r.latency_dram_ns = measure_latency(buffer, r.dram_bytes, hops);
+
+    AlignedAllocator::deallocate(buffer);
+
+    results = r;
+    ready.store(true, std::memory_order_release);
+    return true;
+}
+
+std::string MemoryProbe::get_summary_string() const {
+    if (!has_results()) return "Memory probe: not run";
+
+    std::ostringstream oss;
+    oss << "Memory probe: " << std::fixed << std::setprecision(1)
+        << "read " << results.seq_read_gbps << " GB/s, "
+        << "write " << results.seq_write_gbps << " GB/s, "
+        << "scatter " << results.scatter_gbps << " GB/s, "
+        << "latency L2/L3/DRAM " << results.latency_l2_ns << "/"
+        << results.latency_l3_ns << "/" << results.latency_dram_ns << " ns";
+    return oss.str();
+}
+
+} // namespace Solver1927
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <mutex>
+#include <atomic>
+
+namespace Solver1927 {
+
+/**
+ * Host memory roofline probe
+ * Measures what this machine's memory hierarchy can sustain so that the
+ * per-stage traffic of the collision detector can be reported as a fraction
+ * of the achievable limit (memory-bound vs compute-bound at a glance).
+ */
+class MemoryProbe {
+public:
+    struct Results {
+        double seq_read_gbps = 0.0;     // Streaming read bandwidth (DRAM-sized buffer)
+        double seq_write_gbps = 0.0;    // Streaming write bandwidth (DRAM-sized buffer)
+        double scatter_gbps = 0.0;      // 16-byte random stores, same shape as bucket population
+        double latency_l2_ns = 0.0;     // Dependent-load latency at L2-sized working set
+        double latency_l3_ns = 0.0;     // Dependent-load latency at L3-sized working set
+        double latency_dram_ns = 0.0;   // Dependent-load latency at DRAM-sized working set
+        size_t l2_bytes = 0;
+        size_t l3_bytes = 0;
+        size_t dram_bytes = 0;
+    };
+
+    MemoryProbe() : ready(false) {}
+
+    // Run all measurements (blocking, a few seconds). dram_bytes = 0 picks
+    // a working set well beyond the last level cache.
+    bool run(size_t dram_bytes = 0);
+
+    bool has_results() const { return ready.load(std::memory_order_acquire); }
+    const Results& get_results() const { return results; }
+
+    // One-line summary of the measured limits
+    std::string get_summary_string() const;
+
+private:
+    std::mutex run_mutex;
+    std::atomic<bool> ready;
+    Results results;
+
+    static double measure_read(const uint64_t* buffer, size_t words, int passes);
+    static double measure_write(uint64_t* buffer, size_t words, int passes);
+    static double measure_latency(uint64_t* buffer, size_t bytes, size_t hops);
+    static double measure_scatter(uint64_t* buffer, size_t bytes, size_t stores);
+};
+
+// Global probe instance, filled on demand (-c1927p) and read by the solvers
+extern MemoryProbe g_memory_probe;
+
+} // namespace Solver1927
@@ -0,0 +1,178 @@
+#include "smt_helper.hpp"
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <immintrin.h>
+
+namespace Solver1927 {
+
+bool g_smt_helper_enabled = false;
+
+namespace {
+
+// Logical CPUs already taken by a solver/helper pair, shared by all solvers
+std::mutex g_core_mutex;
+std::vector<int> g_claimed_cpus;
+
+bool is_claimed(int cpu) {
+    return std::find(g_claimed_cpus.begin(), g_claimed_cpus.end(), cpu) != g_claimed_cpus.end();
+}
+
+#ifdef __linux__
+// Parses sysfs cpu lists such as "0,4" or "0-1"
+std::vector<int> read_thread_siblings(int cpu) {
+    std::vector<int> cpus;
+    std::ifstream in("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/thread_siblings_list");
+    std::string list;
+    if (!std::getline(in, list)) return cpus;
+
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        size_t dash = range.find('-');
+        int first = std::atoi(range.c_str());
+        int last = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+        for (int c = first; c <= last; c++) cpus.push_back(c);
+    }
+    return cpus;
+}
+
+bool pin_current_thread(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+#endif
+
+} // anonymous namespace
+
+SmtHelper::SmtHelper() : job_active(false), helper_busy(false), job_cursor(0) {
+    claim_core();
+    thread = std::thread(&SmtHelper::run, this);
+}
+
+SmtHelper::~SmtHelper() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_all();
+    thread.join();
+    release_core();
+}
+
+bool SmtHelper::claim_core() {
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(allowed), &allowed) != 0) return false;
+
+    std::lock_guard<std::mutex> lock(g_core_mutex);
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed) || is_claimed(cpu)) continue;
+
+        for (int sibling : read_thread_siblings(cpu)) {
+            if (sibling == cpu || sibling >= CPU_SETSIZE || !CPU_ISSET(sibling, &allowed) || is_claimed(sibling)) continue;
+            if (!pin_current_thread(cpu)) return false;
+            main_thread = pthread_self();
+            main_affinity = allowed;
+            main_cpu = cpu;
+            helper_cpu = sibling;
+            g_claimed_cpus.push_back(cpu);
+            g_claimed_cpus.push_back(sibling);
+            return true;
+        }
+    }
+#endif
+    return false;
+}
+
+void SmtHelper::release_core() {
+    if (helper_cpu < 0) return;
+#ifdef __linux__
+    // Another thread cannot safely reach the solver thread, which may be gone
+    if (pthread_equal(pthread_self(), main_thread)) {
+        pthread_setaffinity_np(main_thread, sizeof(main_affinity), &main_affinity);
+    }
+#endif
+    std::lock_guard<std::mutex> lock(g_core_mutex);
+    g_claimed_cpus.erase(std::remove_if(g_claimed_cpus.begin(), g_claimed_cpus.end(),
+                                        [this](int cpu) { return cpu == main_cpu || cpu == helper_cpu; }),
+                         g_claimed_cpus.end());
+}
+
+std::string SmtHelper::get_placement_string() const {
+    if (!is_pinned()) return "unpinned (no free SMT sibling pair)";
+    return "solver on cpu " + std::to_string(main_cpu) + ", helper on sibling cpu " + std::to_string(helper_cpu);
+}
+
+void SmtHelper::begin(PrefetchFn fn, const void* context, size_t count, size_t lead_min, size_t lead_max) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job_fn = fn;
+        job_context = context;
+        job_count = count;
+        job_lead_min = lead_min;
+        job_lead_max = lead_max;
+        job_cursor.store(0, std::memory_order_relaxed);
+        helper_busy.store(true, std::memory_order_relaxed);
+        job_active.store(true, std::memory_order_release);
+        job_generation++;
+    }
+    wake.notify_one();
+}
+
+void SmtHelper::end() {
+    job_active.store(false, std::memory_order_release);
+    // The helper may still be touching the job's data until it drops busy
+    while (helper_busy.load(std::memory_order_acquire)) {
+        _mm_pause();
+    }
+}
+
+void SmtHelper::run() {
+#ifdef __linux__
+    if (helper_cpu >= 0) pin_current_thread(helper_cpu);
+#endif
+
+    uint64_t seen_generation = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [&] { return quit || job_generation != seen_generation; });
+        if (quit) return;
+        seen_generation = job_generation;
+
+        PrefetchFn fn = job_fn;
+        const void* context = job_context;
+        size_t count = job_count;
+        size_t lead_min = job_lead_min;
+        size_t lead_max = job_lead_max;
+        lock.unlock();
+
+        size_t item = 0;
+        size_t prefetched = 0;
+        while (item < count && job_active.load(std::memory_order_acquire)) {
+            size_t cursor = job_cursor.load(std::memory_order_relaxed);
+            if (item < cursor + lead_min) {
+                // Fell behind the solver: prefetching here would arrive too late
+                item = cursor + lead_min;
+                continue;
+            }
+            if (item >= cursor + lead_max) {
+                _mm_pause();
+                continue;
+            }
+            fn(context, item++);
+            prefetched++;
+        }
+
+        last_prefetched = prefetched;
+        helper_busy.store(false, std::memory_order_release);
+        lock.lock();
+    }
+}
+
+} // namespace Solver1927
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace Solver1927 {
+
+// Set from the command line (-c1927smt) before the solvers start
+extern bool g_smt_helper_enabled;
+
+/**
+ * Cooperative prefetch thread for the SMT sibling of a solver thread
+ * The solver publishes a job (a prefetch routine over items [0, count)) and
+ * its progress; the helper walks the same items a little ahead and issues the
+ * prefetches, so the sibling's idle issue slots hide the solver's cache misses.
+ * The helper only reads solver data and never stores to it.
+ */
+class SmtHelper {
+public:
+    // Issues the prefetches for item i of the current job
+    using PrefetchFn = void (*)(const void* context, size_t item);
+
+    // Pins the calling (solver) thread and the helper to the two threads of one
+    // free core when the topology allows it. Destroy it on the same thread to
+    // give the solver thread its original affinity back.
+    SmtHelper();
+    ~SmtHelper();
+
+    SmtHelper(const SmtHelper&) = delete;
+    SmtHelper& operator=(const SmtHelper&) = delete;
+
+    // Solver side: start a job, report progress, then finish it before the
+    // data behind context goes away. lead_min/lead_max bound how far ahead of
+    // the published cursor the helper works.
+    void begin(PrefetchFn fn, const void* context, size_t count, size_t lead_min, size_t lead_max);
+    void advance(size_t cursor) { job_cursor.store(cursor, std::memory_order_relaxed); }
+    void end();
+
+    bool is_pinned() const { return helper_cpu >= 0; }
+    std::string get_placement_string() const;
+
+    // Items the helper prefetched in the last job
+    size_t get_last_prefetched() const { return last_prefetched; }
+
+private:
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool quit = false;
+
+    // Current job; written under mutex before job_active is raised
+    PrefetchFn job_fn = nullptr;
+    const void* job_context = nullptr;
+    size_t job_count = 0;
+    size_t job_lead_min = 0;
+    size_t job_lead_max = 0;
+    uint64_t job_generation = 0;
+    std::atomic<bool> job_active;
+    std::atomic<bool> helper_busy;
+    std::atomic<size_t> job_cursor;
+    size_t last_prefetched = 0;
+
+    int main_cpu = -1;
+    int helper_cpu = -1;
+#ifdef __linux__
+    // Solver thread and its affinity before claim_core() pinned it
+    pthread_t main_thread;
+    cpu_set_t main_affinity;
+#endif
+
+    void run();
+    bool claim_core();
+    void release_core();
+};
+
+} // namespace Solver1927
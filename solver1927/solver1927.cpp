@@ -1,4 +1,5 @@
 #include "solver1927.hpp"
+#include "heap_counter.hpp"
 #include <thread>
 #include <chrono>
 #include <iostream>
@@ -30,6 +31,10 @@ bool solver1927::initialize_memory() {
         std::cout << "Solver1927: INFO - Optimal memory usage for L3 cache" << std::endl;
     }
     
+    if (Solver1927::g_memory_probe.has_results()) {
+        std::cout << "Solver1927: " << Solver1927::g_memory_probe.get_summary_string() << std::endl;
+    }
+    
     return true;
 }
 
@@ -112,6 +117,10 @@ void solver1927::solve(const char *tequihash_header,
         return;
     }
     
+#ifdef SOLVER1927_COUNT_ALLOCS
+    uint64_t heap_allocations = Solver1927::get_thread_heap_allocations();
+#endif
+    
     auto* pool = memory_manager.get();
     std::cout << "Solver1927: Starting solve with N=" << N << ", K=" << K << std::endl;
     std::cout << "Header length: " << tequihash_header_len << " bytes" << std::endl;
@@ -139,7 +148,20 @@ void solver1927::solve(const char *tequihash_header,
     }
     
     // Display collision detection statistics
-    std::cout << "Solver1927: " << collision_detector.get_stats_string() << std::endl;
+    std::cout << "Solver1927: ";
+    collision_detector.print_stats(std::cout);
+    std::cout << std::endl;
+    
+#ifdef SOLVER1927_COUNT_ALLOCS
+    // Steady state: after the warm-up solves (the first with the SMT helper, the
+    // second without it) the solve path, solution callback included, must not
+    // touch the heap
+    heap_allocations = Solver1927::get_thread_heap_allocations() - heap_allocations;
+    if (++solves > 2 && heap_allocations > 0) {
+        std::cerr << "Solver1927: WARNING - solve made " << heap_allocations
+                  << " heap allocations" << std::endl;
+    }
+#endif
     
     // Call hash done callback to indicate completion
     hashdonef();
@@ -30,12 +30,25 @@ public:
     solver1927(int platf_id, int dev_id) {}
     virtual ~solver1927() {}
     
+    // The Blake2b state inside is 64-byte aligned, which plain new does not
+    // honour in the miner's C++11 code
+    static void* operator new(size_t size) {
+        void* ptr = Solver1927::AlignedAllocator::allocate(size, alignof(solver1927));
+        if (!ptr) throw std::bad_alloc();
+        return ptr;
+    }
+    static void operator delete(void* ptr) {
+        Solver1927::AlignedAllocator::deallocate(ptr);
+    }
+    
     virtual void start() override {
         initialize_memory();
     }
     
     virtual void stop() override {
         cleanup_memory();
+        // Called on the solver thread, which the helper had pinned
+        collision_detector.release_smt_helper();
     }
     
     virtual void solve(const char *tequihash_header,
@@ -103,6 +116,7 @@ private:
     Solver1927::MemoryManager memory_manager;
     Solver1927::Blake2bManager blake2b_manager;
     Solver1927::CollisionDetector collision_detector;
+    uint64_t solves = 0;  // Debug builds skip the warm-up solves in the allocation check
     
     // Internal methods
     bool initialize_memory();